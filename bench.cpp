@@ -0,0 +1,493 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ndarray.hpp"
+
+
+
+
+/**
+ * Micro-benchmarks for the main evaluation paths, each timed against a
+ * hand-written loop doing the same work ("baseline").
+ *
+ * Usage: bench [--large] [filter]
+ *
+ *     --large   also run the DRAM-sized problems (several hundred MB)
+ *     filter    only run benchmarks whose name contains this string
+ *
+ * Output is CSV on stdout, one row per benchmark, rank and problem size:
+ *
+ *     benchmark,rank,size,elements,ns_per_element,baseline_ns_per_element,ratio
+ *
+ * Times are the best of several repetitions. Rows from two builds can be
+ * compared with any diff or spreadsheet tool.
+ */
+
+
+
+
+//=============================================================================
+volatile double sink = 0.0;
+
+struct options_t
+{
+    bool large = false;
+    std::string filter;
+};
+
+struct size_class_t
+{
+    const char* name;
+    std::size_t elements;
+};
+
+template<typename Function>
+double time_best_of(std::size_t repetitions, Function&& fn)
+{
+    auto best = 1e300;
+
+    for (std::size_t n = 0; n < repetitions; ++n)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+bool selected(const options_t& options, const char* name)
+{
+    return options.filter.empty() || std::string(name).find(options.filter) != std::string::npos;
+}
+
+template<typename LibraryFunction, typename BaselineFunction>
+void run(const options_t& options, const char* name, std::size_t rank, const char* size, std::size_t elements, LibraryFunction&& library, BaselineFunction&& baseline)
+{
+    if (! selected(options, name))
+    {
+        return;
+    }
+    auto repetitions = std::min(std::size_t(200), std::max(std::size_t(3), std::size_t(20000000) / elements));
+    auto t_library  = 1e9 * time_best_of(repetitions, library) / elements;
+    auto t_baseline = 1e9 * time_best_of(repetitions, baseline) / elements;
+
+    std::printf("%s,%zu,%s,%zu,%.4f,%.4f,%.3f\n", name, rank, size, elements, t_library, t_baseline, t_library / t_baseline);
+    std::fflush(stdout);
+}
+
+template<std::size_t Rank>
+auto random_array(nd::shape_t<Rank> shape, std::size_t seed)
+{
+    auto strides = nd::make_strides_row_major(shape);
+
+    return nd::index_array(shape) | nd::transform([strides, seed] (auto index)
+    {
+        auto n = strides.compute_offset(index) * 2654435761u + seed * 40503u;
+        return double(n % 1000) / 1000.0;
+    }) | nd::to_shared();
+}
+
+template<std::size_t Rank>
+bool step(std::size_t* index, const nd::shape_t<Rank>& shape)
+{
+    for (std::size_t n = Rank; n-- > 0;)
+    {
+        if (++index[n] < shape[n])
+        {
+            return true;
+        }
+        index[n] = 0;
+    }
+    return false;
+}
+
+
+
+
+//=============================================================================
+template<typename Array, std::size_t... Is>
+auto cartesian_product_of(const std::vector<Array>& arrays, std::index_sequence<Is...>)
+{
+    return nd::cartesian_product(arrays[Is]...);
+}
+
+template<std::size_t Rank, std::size_t... Is>
+auto make_tuple_at(const std::vector<const double*>& x, const std::size_t* index, std::index_sequence<Is...>)
+{
+    return std::make_tuple(x[Is][index[Is]]...);
+}
+
+
+
+
+//=============================================================================
+template<std::size_t Rank>
+void bench_rank(const options_t& options, size_class_t size_class)
+{
+    auto edge = std::size_t(std::round(std::pow(double(size_class.elements), 1.0 / Rank)));
+    edge += edge % 2;
+
+    auto shape = nd::make_uniform_shape<Rank>(edge);
+    auto N = shape.volume();
+    auto A = random_array(shape, 1);
+    auto B = random_array(shape, 2);
+    auto a = A.data();
+    auto b = B.data();
+    auto size = size_class.name;
+
+    run(options, "to_shared(A + B)", Rank, size, N,
+    [&] { sink = ((A + B) | nd::to_shared()).data()[N - 1]; },
+    [&]
+    {
+        auto c = std::unique_ptr<double[]>(new double[N]);
+        for (std::size_t i = 0; i < N; ++i) c[i] = a[i] + b[i];
+        sink = c[N - 1];
+    });
+
+    run(options, "to_shared(transform(A))", Rank, size, N,
+    [&] { sink = (A | nd::transform([] (double x) { return x * x + 1.0; }) | nd::to_shared()).data()[N - 1]; },
+    [&]
+    {
+        auto c = std::unique_ptr<double[]>(new double[N]);
+        for (std::size_t i = 0; i < N; ++i) c[i] = a[i] * a[i] + 1.0;
+        sink = c[N - 1];
+    });
+
+    run(options, "sum()", Rank, size, N,
+    [&] { sink = A | nd::sum(); },
+    [&]
+    {
+        // Kahan-compensated, as is nd::sum for floating point values
+        auto s = 0.0, c = 0.0;
+        for (std::size_t i = 0; i < N; ++i) { auto y = a[i] - c; auto t = s + y; c = (t - s) - y; s = t; }
+        sink = s;
+    });
+
+    if constexpr (Rank > 1)
+    {
+        auto inner = N / shape[0];
+        auto outer = N / shape[Rank - 1];
+
+        run(options, "collect(sum()).along_axis(0)", Rank, size, N,
+        [&] { sink = (A | nd::collect(nd::sum()).along_axis(0) | nd::to_shared()).data()[0]; },
+        [&]
+        {
+            auto s = std::vector<double>(inner), c = std::vector<double>(inner);
+            for (std::size_t i = 0; i < shape[0]; ++i)
+                for (std::size_t j = 0; j < inner; ++j) { auto y = a[i * inner + j] - c[j]; auto t = s[j] + y; c[j] = (t - s[j]) - y; s[j] = t; }
+            sink = s[0];
+        });
+
+        run(options, "collect(sum()).along_axis(last)", Rank, size, N,
+        [&] { sink = (A | nd::collect(nd::sum()).along_axis(Rank - 1) | nd::to_shared()).data()[0]; },
+        [&]
+        {
+            auto r = std::vector<double>(outer);
+            for (std::size_t i = 0; i < outer; ++i)
+            {
+                auto s = 0.0, c = 0.0;
+                for (std::size_t j = 0; j < edge; ++j) { auto y = a[i * edge + j] - c; auto t = s + y; c = (t - s) - y; s = t; }
+                r[i] = s;
+            }
+            sink = r[0];
+        });
+    }
+
+    run(options, "where(A < 0.5)", Rank, size, N,
+    [&] { sink = double(nd::where(A < 0.5).size()); },
+    [&]
+    {
+        auto result = std::vector<nd::index_t<Rank>>();
+        std::size_t index[Rank] = {};
+        for (std::size_t i = 0; i < N; ++i, step<Rank>(index, shape))
+        {
+            if (a[i] < 0.5)
+            {
+                auto j = nd::index_t<Rank>();
+                std::copy(index, index + Rank, j.begin());
+                result.push_back(j);
+            }
+        }
+        sink = double(result.size());
+    });
+
+    run(options, "select_from().jumping(1, .., 2)", Rank, size, N,
+    [&]
+    {
+        auto jumps = nd::make_uniform_jumps<Rank>(1);
+        jumps[Rank - 1] = 2;
+        sink = (A | nd::select_from(nd::make_uniform_index<Rank>(0)).to(shape.last_index()).jumping(jumps) | nd::to_shared()).data()[0];
+    },
+    [&]
+    {
+        auto c = std::unique_ptr<double[]>(new double[N / 2]);
+        for (std::size_t i = 0; i < N / 2; ++i) c[i] = a[2 * i];
+        sink = c[0];
+    });
+
+    run(options, "concat(B)", Rank, size, 2 * N,
+    [&] { sink = (A | nd::concat(B) | nd::to_shared()).data()[N]; },
+    [&]
+    {
+        auto c = std::unique_ptr<double[]>(new double[2 * N]);
+        std::memcpy(c.get(), a, N * sizeof(double));
+        std::memcpy(c.get() + N, b, N * sizeof(double));
+        sink = c[N];
+    });
+
+    run(options, "zip_arrays(A, B)", Rank, size, N,
+    [&] { sink = std::get<1>((nd::zip_arrays(A, B) | nd::to_shared()).data()[N - 1]); },
+    [&]
+    {
+        auto c = std::unique_ptr<std::tuple<double, double>[]>(new std::tuple<double, double>[N]);
+        for (std::size_t i = 0; i < N; ++i) c[i] = std::make_tuple(a[i], b[i]);
+        sink = std::get<1>(c[N - 1]);
+    });
+
+    run(options, "zip_arrays(A, B) | to_shared_soa()", Rank, size, N,
+    [&] { sink = std::get<1>((nd::zip_arrays(A, B) | nd::to_shared_soa())(shape.last_index())); },
+    [&]
+    {
+        auto c = std::unique_ptr<double[]>(new double[N]);
+        auto d = std::unique_ptr<double[]>(new double[N]);
+        std::memcpy(c.get(), a, N * sizeof(double));
+        std::memcpy(d.get(), b, N * sizeof(double));
+        sink = d[N - 1];
+    });
+
+    auto axes = std::vector<decltype(random_array(nd::make_shape(edge), 0))>();
+    auto x = std::vector<const double*>();
+
+    for (std::size_t n = 0; n < Rank; ++n)
+    {
+        axes.push_back(random_array(nd::make_shape(edge), n));
+        x.push_back(axes.back().data());
+    }
+
+    run(options, "cartesian_product(x, ..)", Rank, size, N,
+    [&] { sink = std::get<0>((cartesian_product_of(axes, std::make_index_sequence<Rank>()) | nd::to_shared()).data()[N - 1]); },
+    [&]
+    {
+        using tuple_type = decltype(make_tuple_at<Rank>(x, nullptr, std::make_index_sequence<Rank>()));
+        auto c = std::unique_ptr<tuple_type[]>(new tuple_type[N]);
+        std::size_t index[Rank] = {};
+        for (std::size_t i = 0; i < N; ++i, step<Rank>(index, shape)) c[i] = make_tuple_at<Rank>(x, index, std::make_index_sequence<Rank>());
+        sink = std::get<0>(c[N - 1]);
+    });
+}
+
+
+
+
+//=============================================================================
+void bench_index_arithmetic(const options_t& options)
+{
+    constexpr std::size_t ni = 128, nj = 128, nk = 128;
+    auto shape = nd::make_shape(ni, nj, nk);
+    auto strides = nd::make_strides_row_major(shape);
+    auto data = std::vector<double>(shape.volume(), 1.0);
+    auto N = shape.volume();
+
+    auto hand_written = [&]
+    {
+        auto s = 0.0;
+        for (std::size_t i = 0; i < ni; ++i)
+            for (std::size_t j = 0; j < nj; ++j)
+                for (std::size_t k = 0; k < nk; ++k)
+                    s += data[(i * nj + j) * nk + k];
+        sink = s;
+    };
+
+    run(options, "index: compute_offset", 3, "L3", N,
+    [&]
+    {
+        auto s = 0.0;
+        for (std::size_t i = 0; i < ni; ++i)
+            for (std::size_t j = 0; j < nj; ++j)
+                for (std::size_t k = 0; k < nk; ++k)
+                    s += data[strides.compute_offset(nd::make_index(i, j, k))];
+        sink = s;
+    }, hand_written);
+
+    run(options, "index: access_pattern_t iteration", 3, "L3", N,
+    [&]
+    {
+        auto s = 0.0;
+        for (const auto& index : nd::make_access_pattern(shape)) s += data[strides.compute_offset(index)];
+        sink = s;
+    }, hand_written);
+
+    auto selected = nd::make_access_pattern(shape).with_jumps(1, 1, 2);
+
+    run(options, "index: map_index (jumps 1, 1, 2)", 3, "L3", selected.size(),
+    [&]
+    {
+        auto s = 0.0;
+        for (const auto& index : nd::make_access_pattern(selected.shape())) s += data[strides.compute_offset(selected.map_index(index))];
+        sink = s;
+    },
+    [&]
+    {
+        auto s = 0.0;
+        for (std::size_t i = 0; i < ni; ++i)
+            for (std::size_t j = 0; j < nj; ++j)
+                for (std::size_t k = 0; k < nk; k += 2)
+                    s += data[(i * nj + j) * nk + k];
+        sink = s;
+    });
+}
+
+
+
+
+//=============================================================================
+void bench_io(const options_t& options, size_class_t size_class)
+{
+    auto edge = std::size_t(std::sqrt(double(size_class.elements)));
+    auto A = random_array(nd::make_shape(edge, edge), 1);
+    auto a = A.data();
+    auto N = A.size();
+    auto size = size_class.name;
+    auto filename = std::string("bench_io.npy");
+    auto raw_filename = std::string("bench_io.bin");
+
+    run(options, "save_npy", 2, size, N,
+    [&] { nd::save_npy(filename, A); },
+    [&]
+    {
+        auto file = std::fopen(raw_filename.data(), "wb");
+        std::fwrite(a, sizeof(double), N, file);
+        std::fclose(file);
+    });
+
+    auto read_raw = [&]
+    {
+        auto c = std::unique_ptr<double[]>(new double[N]);
+        auto file = std::fopen(raw_filename.data(), "rb");
+        sink = double(std::fread(c.get(), sizeof(double), N, file));
+        std::fclose(file);
+        sink = c[N - 1];
+    };
+
+    run(options, "load_npy", 2, size, N,
+    [&] { sink = nd::load_npy<double, 2>(filename).data()[N - 1]; }, read_raw);
+
+    run(options, "map_npy | to_shared()", 2, size, N,
+    [&] { sink = (nd::map_npy<double, 2>(filename) | nd::to_shared()).data()[N - 1]; }, read_raw);
+
+    std::remove(filename.data());
+    std::remove(raw_filename.data());
+}
+
+
+
+
+//=============================================================================
+void bench_transpose(const options_t& options)
+{
+    if (! options.large || ! selected(options, "permute_axes(1, 0) | to_shared()"))
+    {
+        return;
+    }
+    constexpr std::size_t n = 2048;
+    auto A = random_array(nd::make_shape(n, n), 1);
+    auto a = A.data();
+    auto N = n * n;
+
+    run(options, "permute_axes(1, 0) | to_shared()", 2, "DRAM", N,
+    [&] { sink = (A | nd::permute_axes(1, 0) | nd::to_shared()).data()[N - 1]; },
+    [&]
+    {
+        auto c = std::unique_ptr<double[]>(new double[N]);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = 0; j < n; ++j)
+                c[i * n + j] = a[j * n + i];
+        sink = c[N - 1];
+    });
+}
+
+
+
+
+//=============================================================================
+void bench_gather(const options_t& options)
+{
+    if (! options.large || ! (selected(options, "read_indexes | to_shared()") || selected(options, "gather(plan)")))
+    {
+        return;
+    }
+    constexpr std::size_t n = 4096;
+    constexpr std::size_t N = 1 << 22;
+    auto A = random_array(nd::make_shape(n, n), 1);
+    auto a = A.data();
+    auto indexes = nd::make_unique_array<nd::index_t<2>>(N);
+
+    for (std::size_t k = 0; k < N; ++k)
+    {
+        auto h = k * 2654435761u;
+        indexes(k) = nd::make_index(h % n, (h / n) % n);
+    }
+    auto I = std::move(indexes).shared();
+    auto plan = nd::make_gather_plan(I, A.shape());
+
+    auto hand_written = [&]
+    {
+        auto c = std::unique_ptr<double[]>(new double[N]);
+        for (std::size_t k = 0; k < N; ++k)
+            c[k] = a[I(k)[0] * n + I(k)[1]];
+        sink = c[N - 1];
+    };
+
+    run(options, "read_indexes | to_shared()", 2, "DRAM", N,
+    [&] { sink = (A | nd::read_indexes(I) | nd::to_shared()).data()[N - 1]; }, hand_written);
+
+    run(options, "gather(plan)", 2, "DRAM", N,
+    [&] { sink = (A | nd::gather(plan)).data()[N - 1]; }, hand_written);
+}
+
+
+
+
+//=============================================================================
+int main(int argc, const char* argv[])
+{
+    auto options = options_t();
+
+    for (int n = 1; n < argc; ++n)
+    {
+        if (std::strcmp(argv[n], "--large") == 0)
+        {
+            options.large = true;
+        }
+        else
+        {
+            options.filter = argv[n];
+        }
+    }
+
+    auto sizes = std::vector<size_class_t>{{"L1", 1 << 11}, {"L2", 1 << 17}, {"L3", 1 << 22}};
+
+    if (options.large)
+    {
+        sizes.push_back({"DRAM", 1 << 26});
+    }
+    std::printf("benchmark,rank,size,elements,ns_per_element,baseline_ns_per_element,ratio\n");
+
+    for (const auto& size : sizes)
+    {
+        bench_rank<1>(options, size);
+        bench_rank<2>(options, size);
+        bench_rank<3>(options, size);
+        bench_rank<4>(options, size);
+        bench_io(options, size);
+    }
+    bench_index_arithmetic(options);
+    bench_transpose(options);
+    bench_gather(options);
+    return 0;
+}
@@ -27,12 +27,73 @@
 
 #pragma once
 #include <algorithm>         // std::all_of
+#include <array>             // std::array
+#include <atomic>            // std::atomic
+#include <chrono>            // std::chrono::steady_clock
+#include <condition_variable>// std::condition_variable
+#include <cstring>           // std::memcpy
+#include <deque>             // std::deque
+#include <exception>         // std::exception_ptr
+#include <fstream>           // std::ifstream
 #include <functional>        // std::ref
+#include <future>            // std::packaged_task
 #include <initializer_list>  // std::initializer_list
 #include <iterator>          // std::distance
+#include <map>               // std::map
 #include <memory>            // std::shared_ptr
+#include <mutex>             // std::mutex
 #include <numeric>           // std::accumulate
+#include <string>            // std::string
+#include <thread>            // std::thread
+#include <unordered_map>     // std::unordered_map
+#include <type_traits>       // std::is_trivially_copyable
 #include <utility>           // std::index_sequence
+#include <vector>            // std::vector
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>           // open
+#include <sys/mman.h>        // mmap
+#include <sys/stat.h>        // fstat
+#include <unistd.h>          // close
+#define NDARRAY_HAVE_MMAP 1
+#endif
+
+
+
+
+// Width in bytes of the SIMD registers targeted by simd_pack_t; may be
+// overridden on the command line.
+//=============================================================================
+#ifndef NDARRAY_SIMD_BYTES
+#if defined(__AVX512F__)
+#define NDARRAY_SIMD_BYTES 64
+#elif defined(__AVX__)
+#define NDARRAY_SIMD_BYTES 32
+#else
+#define NDARRAY_SIMD_BYTES 16
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define NDARRAY_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define NDARRAY_PREFETCH(address)
+#endif
+
+
+
+
+// Instrumentation hooks, which compile to nothing unless NDARRAY_ENABLE_STATS
+// is defined; the counters are read with nd::stats().
+//=============================================================================
+#ifdef NDARRAY_ENABLE_STATS
+#define NDARRAY_STATS_ADD(counter, n) nd::detail::stats_counters().counter.fetch_add(n, std::memory_order_relaxed)
+#define NDARRAY_STATS_ACCESS(op, n) nd::detail::count_accesses(nd::detail::counted_operator::op, n)
+#define NDARRAY_STATS_TIMER(counter) nd::detail::scoped_timer_t ndarray_scoped_timer(nd::detail::stats_counters().counter)
+#else
+#define NDARRAY_STATS_ADD(counter, n) ((void) 0)
+#define NDARRAY_STATS_ACCESS(op, n) ((void) 0)
+#define NDARRAY_STATS_TIMER(counter) ((void) 0)
+#endif
 
 
 
@@ -52,21 +113,48 @@ namespace nd
     template<std::size_t Rank> class memory_strides_t;
     template<std::size_t Rank> class access_pattern_t;
     template<typename Provider> class array_t;
-    template<typename ValueType> class buffer_t;
+    template<typename ValueType, std::size_t Alignment=64> class allocator_t;
+    template<typename ValueType, typename Allocator=allocator_t<ValueType>> class buffer_t;
+    class memory_pool_t;
+    struct uninitialized_t {};
+    inline constexpr uninitialized_t uninitialized {};
 
 
     // array and access pattern factory functions
     //=========================================================================
-    template<typename... Args> auto make_shape(Args... args);
-    template<typename... Args> auto make_index(Args... args);
+    template<typename... Args> constexpr auto make_shape(Args... args);
+    template<typename... Args> constexpr auto make_index(Args... args);
     template<typename... Args> auto make_jumps(Args... args);
     template<std::size_t Rank, typename Arg> auto make_uniform_shape(Arg arg);
     template<std::size_t Rank, typename Arg> auto make_uniform_index(Arg arg);
     template<std::size_t Rank, typename Arg> auto make_uniform_jumps(Arg arg);
     template<std::size_t Rank> auto make_strides_row_major(shape_t<Rank> shape);
+    template<std::size_t Rank> auto make_strides_column_major(shape_t<Rank> shape);
     template<std::size_t Rank> auto make_access_pattern(shape_t<Rank> shape);
     template<typename... Args> auto make_access_pattern(Args... args);
     template<std::size_t NumPartitions, std::size_t Rank> auto partition_shape(shape_t<Rank> shape);
+    template<std::size_t Rank> auto partition_shape(shape_t<Rank> shape, std::size_t num_partitions);
+    template<std::size_t Rank> auto partition_tiles(shape_t<Rank> shape, std::size_t num_tiles);
+
+
+    // execution support structs
+    //=========================================================================
+    class thread_pool_t;
+    template<std::size_t Rank, typename ValueType> class double_buffer_t;
+    template<std::size_t Rank, std::size_t SourceRank> class gather_plan_t;
+
+
+    // instrumentation (collected only if NDARRAY_ENABLE_STATS is defined)
+    //=========================================================================
+    struct stats_t;
+    inline stats_t stats();
+    inline void reset_stats();
+
+
+    // SIMD support structs
+    //=========================================================================
+    template<typename ValueType, std::size_t Width> class simd_pack_t;
+    template<typename ValueType> constexpr std::size_t simd_width = std::max(std::size_t(1), std::size_t(NDARRAY_SIMD_BYTES) / sizeof(ValueType));
 
 
     // provider types
@@ -75,6 +163,12 @@ namespace nd
     template<std::size_t Rank, typename ValueType> class shared_provider_t;
     template<std::size_t Rank, typename ValueType> class unique_provider_t;
     template<std::size_t Rank, typename ValueType> class uniform_provider_t;
+    template<std::size_t Rank, typename ValueType> class mmap_provider_t;
+    template<std::size_t Rank, typename ValueType> class view_provider_t;
+    template<typename Provider> class cached_provider_t;
+    template<std::size_t Rank, typename ValueType> class block_sparse_provider_t;
+    template<std::size_t Rank, typename... ValueTypes> class soa_provider_t;
+    template<typename ValueType, std::size_t... Dims> class static_provider_t;
 
 
     // provider factory functions
@@ -82,29 +176,56 @@ namespace nd
     template<typename ValueType, std::size_t Rank> auto make_shared_provider(shape_t<Rank> shape);
     template<typename ValueType, typename... Args> auto make_shared_provider(Args... args);
     template<typename ValueType, std::size_t Rank> auto make_unique_provider(shape_t<Rank> shape);
+    template<typename ValueType, std::size_t Rank> auto make_unique_provider(shape_t<Rank> shape, uninitialized_t);
     template<typename ValueType, typename... Args> auto make_unique_provider(Args... args);
     template<typename ValueType, std::size_t Rank> auto make_uniform_provider(ValueType value, shape_t<Rank> shape);
     template<typename ValueType, typename... Args> auto make_uniform_provider(ValueType value, Args... args);
     template<typename Provider> auto evaluate_as_shared(Provider&&);
     template<typename Provider> auto evaluate_as_unique(Provider&&);
+    template<typename Provider> auto evaluate_as_shared(Provider&&, thread_pool_t& pool);
+    template<typename Provider> auto evaluate_as_unique(Provider&&, thread_pool_t& pool);
+    template<typename Provider, std::size_t Rank> auto evaluate_as_shared(Provider&&, shape_t<Rank> tile_shape);
+    template<typename Provider, std::size_t Rank> auto evaluate_as_unique(Provider&&, shape_t<Rank> tile_shape);
+    template<typename Provider, std::size_t Rank> auto evaluate_as_shared(Provider&&, thread_pool_t& pool, shape_t<Rank> tile_shape);
+    template<typename Provider, std::size_t Rank> auto evaluate_as_unique(Provider&&, thread_pool_t& pool, shape_t<Rank> tile_shape);
+    template<typename TargetArrayType, typename SourceArrayType> void evaluate_into(TargetArrayType& target, const SourceArrayType& source);
+    template<typename TargetArrayType, typename SourceArrayType> void evaluate_into(TargetArrayType& target, const SourceArrayType& source, thread_pool_t& pool);
+    template<typename ArrayType, typename Sink> void evaluate_in_chunks(const ArrayType& array, std::size_t rows_per_chunk, Sink&& sink);
+    template<typename ArrayType, typename Sink> void evaluate_in_chunks(const ArrayType& array, std::size_t rows_per_chunk, Sink&& sink, thread_pool_t& pool);
+    template<typename ArrayType> auto evaluate_async(ArrayType array, thread_pool_t& pool);
+    template<typename ValueType, typename Function> auto then(std::shared_future<ValueType> future, thread_pool_t& pool, Function fn);
 
 
     // array factory functions
     //=========================================================================
-    template<typename Provider> auto make_array(Provider&&);
+    template<typename Provider> constexpr auto make_array(Provider&&);
     template<typename Mapping, std::size_t Rank> auto make_array(Mapping mapping, shape_t<Rank> shape);
     template<typename ValueType, std::size_t Rank> auto make_shared_array(shape_t<Rank> shape);
     template<typename ValueType, typename... Args> auto make_shared_array(Args... args);
     template<typename ValueType, std::size_t Rank> auto make_unique_array(shape_t<Rank> shape);
     template<typename ValueType, typename... Args> auto make_unique_array(Args... args);
+    template<typename ValueType, std::size_t... Dims> constexpr auto make_static_array(std::array<ValueType, (Dims * ... * 1)> values = {});
     template<std::size_t Rank> auto index_array(shape_t<Rank> shape);
     template<typename... Args> auto index_array(Args... args);
     template<typename... ArrayTypes> auto zip_arrays(ArrayTypes... arrays);
     template<typename... ArrayTypes> auto cartesian_product(ArrayTypes... arrays);
     template<typename ArrayType> auto where(ArrayType array);
+    template<typename ArrayType> auto where(ArrayType array, thread_pool_t& pool);
+    template<typename ArrayType> auto where_offsets(ArrayType array);
+    template<typename ArrayType> auto where_offsets(ArrayType array, thread_pool_t& pool);
+    template<std::size_t SourceRank, typename ArrayType> auto make_gather_plan(ArrayType array_of_indexes, shape_t<SourceRank> source_shape);
     template<typename ValueType=int, typename... Args> auto zeros(Args... args);
     template<typename ValueType=int, typename... Args> auto ones(Args... args);
     template<typename ValueType, std::size_t Rank> auto promote(ValueType, shape_t<Rank>);
+    template<typename ValueType, std::size_t Rank> auto make_view(ValueType* data, shape_t<Rank> shape);
+    template<typename ValueType, std::size_t Rank> auto make_view(ValueType* data, shape_t<Rank> shape, memory_strides_t<Rank> strides);
+    template<typename ValueType, std::size_t Rank> auto load_npy(const std::string& filename);
+    template<typename ValueType, std::size_t Rank> auto map_npy(const std::string& filename);
+
+
+    // I/O functions
+    //=========================================================================
+    template<typename ArrayType> void save_npy(const std::string& filename, const ArrayType& array);
 
 
     // array operator support structs
@@ -122,18 +243,35 @@ namespace nd
     //=========================================================================
     inline auto to_shared();
     inline auto to_unique();
+    inline auto to_shared_parallel(thread_pool_t& pool);
+    inline auto to_unique_parallel(thread_pool_t& pool);
+    inline auto evaluate_on(thread_pool_t& pool);
+    template<std::size_t Rank> auto to_shared(shape_t<Rank> tile_shape);
+    template<std::size_t Rank> auto to_unique(shape_t<Rank> tile_shape);
+    template<std::size_t Rank> auto to_shared_parallel(thread_pool_t& pool, shape_t<Rank> tile_shape);
+    template<std::size_t Rank> auto to_unique_parallel(thread_pool_t& pool, shape_t<Rank> tile_shape);
     inline auto bounds_check();
     inline auto sum();
     inline auto all();
     inline auto any();
+    inline auto sum_on(thread_pool_t& pool);
+    template<std::size_t Rank> auto sum(shape_t<Rank> tile_shape);
+    template<std::size_t Rank> auto sum_on(thread_pool_t& pool, shape_t<Rank> tile_shape);
+    inline auto all_on(thread_pool_t& pool);
+    inline auto any_on(thread_pool_t& pool);
+    template<typename Function, typename ValueType> auto reduce_on(thread_pool_t& pool, Function function, ValueType identity);
     inline auto shift_by(int delta);
     inline auto select_axis(std::size_t axis_to_select);
     inline auto freeze_axis(std::size_t axis_to_freeze);
     template<typename OperatorType> auto collect(OperatorType reduction);
     template<typename ArrayType> auto concat(ArrayType array_to_concat);
     template<typename ArrayType> auto read_indexes(ArrayType array_of_indexes);
+    template<std::size_t Rank, std::size_t SourceRank> auto gather(gather_plan_t<Rank, SourceRank> plan);
+    template<std::size_t Rank, std::size_t SourceRank> auto gather_parallel(thread_pool_t& pool, gather_plan_t<Rank, SourceRank> plan);
     template<std::size_t Rank> auto reshape(shape_t<Rank> shape);
     template<typename... Args> auto reshape(Args... args);
+    template<std::size_t Rank> auto permute_axes(index_t<Rank> axes);
+    template<typename... Args> auto permute_axes(Args... args);
     template<std::size_t Rank> auto select(access_pattern_t<Rank>);
     template<std::size_t Rank, typename ArrayType> auto replace(access_pattern_t<Rank>, ArrayType);
     template<std::size_t Rank> auto select_from(index_t<Rank> starting_index);
@@ -144,6 +282,15 @@ namespace nd
     template<typename... Args> auto read_index(Args... args);
     template<typename Function> auto transform(Function function);
     template<typename Function> auto binary_op(Function function);
+    template<typename Function> auto vectorized(Function function);
+    inline auto cache();
+    template<typename ArrayType> auto stencil(ArrayType kernel);
+    template<std::size_t Rank> auto cache(shape_t<Rank> tile_shape);
+    template<std::size_t Rank, typename ValueType> auto to_block_sparse(shape_t<Rank> tile_shape, ValueType background);
+    template<std::size_t Rank, typename ValueType> auto to_block_sparse_parallel(thread_pool_t& pool, shape_t<Rank> tile_shape, ValueType background);
+    inline auto to_shared_soa();
+    inline auto to_shared_soa_parallel(thread_pool_t& pool);
+    inline auto unzip();
 
 
     // array query support
@@ -160,6 +307,9 @@ namespace nd
     template<typename ValueType, std::size_t Rank>
     using unique_array = array_t<unique_provider_t<Rank, ValueType>>;
 
+    template<typename ValueType, std::size_t... Dims>
+    using static_array = array_t<static_provider_t<ValueType, Dims...>>;
+
 
     // algorithm support structs
     //=========================================================================
@@ -203,7 +353,195 @@ namespace nd
 
         template<typename ResultSequence, typename SourceSequence, typename IndexContainer>
         auto remove_elements(const SourceSequence& source, IndexContainer indexes);
+
+        template<typename SequenceA, typename SequenceB, std::size_t... Is>
+        std::size_t inner_product(const SequenceA& a, const SequenceB& b, std::index_sequence<Is...>);
+
+        template<typename SequenceA, typename SequenceB, typename Compare, std::size_t... Is>
+        constexpr bool all_elements(const SequenceA& a, const SequenceB& b, Compare compare, std::index_sequence<Is...>);
+
+        template<std::size_t Rank>
+        auto partition_for_pool(shape_t<Rank> shape, const thread_pool_t& pool);
+
+        template<std::size_t Rank>
+        auto tiles_for_pool(shape_t<Rank> shape, const thread_pool_t& pool);
+
+        template<typename ValueType, typename Function>
+        auto reduce_pairwise(std::vector<ValueType> values, Function&& fn, ValueType identity);
+
+        template<typename ResultType, typename ArrayType, std::size_t Rank>
+        auto sum_region(const ArrayType& array, const access_pattern_t<Rank>& region);
+
+        template<typename Provider, std::size_t Rank, typename ValueType>
+        void evaluate_slab(const Provider& source, const access_pattern_t<Rank>& slab, ValueType* target);
+
+        template<typename Provider, std::size_t Rank, typename ValueType>
+        void evaluate_slab(const Provider& source, const access_pattern_t<Rank>& slab, const shape_t<Rank>& tile_shape, ValueType* target);
+
+        template<typename Provider, std::size_t Rank, typename ValueType>
+        void evaluate_region(const Provider& source, const access_pattern_t<Rank>& region, ValueType* target);
+
+        template<typename Provider, std::size_t Rank, typename ValueType>
+        void evaluate_region(const Provider& source, const access_pattern_t<Rank>& region, const shape_t<Rank>& tile_shape, ValueType* target);
+
+        template<std::size_t Rank>
+        bool is_slab(const access_pattern_t<Rank>& region, const shape_t<Rank>& shape);
+
+        template<typename TargetArrayType, typename SourceArrayType>
+        void check_evaluation_target(const TargetArrayType& target, const SourceArrayType& source);
+
+        template<typename ArrayType, typename Sink, typename Evaluator>
+        void stream_chunks(const ArrayType& array, std::size_t rows_per_chunk, Sink& sink, Evaluator&& evaluate);
+
+        template<typename Provider, std::size_t Rank, typename ValueType, typename Runner>
+        auto make_block_sparse(const Provider& source, shape_t<Rank> tile_shape, ValueType background, Runner&& run);
+
+        template<typename Provider, typename Runner, std::size_t... Is>
+        auto make_soa(const Provider& source, const std::vector<access_pattern_t<Provider::rank>>& regions, Runner&& run, std::index_sequence<Is...>);
+
+        template<typename ArrayType, std::size_t... Is>
+        auto unzip_components(const ArrayType& array, std::index_sequence<Is...>);
+
+        template<bool FlatOffsets, typename ArrayType, typename Runner>
+        auto find_indexes(ArrayType array, const std::vector<access_pattern_t<ArrayType::rank>>& regions, Runner&& run);
+
+        template<typename ArrayType, std::size_t Rank, std::size_t SourceRank, typename Runner>
+        auto gather_planned(const ArrayType& array, const gather_plan_t<Rank, SourceRank>& plan, std::size_t num_tasks, Runner&& run);
+
+        template<std::size_t Rank>
+        auto index_at_offset(std::size_t offset, const memory_strides_t<Rank>& strides);
+
+        template<typename ResultType, typename ArrayType, std::size_t Rank>
+        auto sum_tiles(const ArrayType& array, const access_pattern_t<Rank>& region, const shape_t<Rank>& tile_shape);
+
+        template<typename Provider, std::size_t Rank, typename ValueType>
+        void evaluate_row(const Provider& provider, const index_t<Rank>& index, ValueType* target, std::size_t count);
+
+        template<std::size_t Rank, typename Function>
+        void for_each_row(const access_pattern_t<Rank>& region, Function&& fn);
+
+        template<typename Provider, std::size_t Rank, typename ValueType>
+        const ValueType* read_row(const Provider& provider, const index_t<Rank>& index, ValueType* block, std::size_t count);
+
+        template<typename Function, typename ValueType, typename... SourceTypes>
+        void apply_elementwise(const Function& function, ValueType* target, std::size_t count, const SourceTypes*... sources);
+
+        template<typename Function> struct vectorized_t;
+        template<typename Function> struct is_vectorized_function : std::false_type {};
+        template<typename Function> struct is_vectorized_function<vectorized_t<Function>> : std::true_type {};
+        template<> struct is_vectorized_function<std::plus<>> : std::true_type {};
+        template<> struct is_vectorized_function<std::minus<>> : std::true_type {};
+        template<> struct is_vectorized_function<std::multiplies<>> : std::true_type {};
+        template<> struct is_vectorized_function<std::divides<>> : std::true_type {};
+        template<> struct is_vectorized_function<std::negate<>> : std::true_type {};
+
+        template<typename ArrayType, typename Function> class transform_mapping_t;
+        template<typename... ArrayTypes> class zip_mapping_t;
+        template<typename ArrayType, typename ConcatArrayType> class concat_mapping_t;
+        template<std::size_t Rank, typename ReplacementArrayType, typename PatchArrayType> class replace_mapping_t;
+        template<typename Function, typename ArrayTypeA, typename ArrayTypeB> class binary_op_mapping_t;
+        template<typename ArrayType> class axis_sum_mapping_t;
+        template<typename ArrayType, typename WeightType> class stencil_mapping_t;
+        template<typename IndexArrayType, typename ArrayType> class gather_mapping_t;
+
+        /**
+         * The non-zero weights of a stencil kernel, grouped by their offset on
+         * all but the last axis: the taps of a group all read the same row.
+         */
+        template<std::size_t Rank, typename WeightType>
+        struct stencil_tap_group_t
+        {
+            index_t<Rank> offset;
+            std::vector<std::pair<std::size_t, WeightType>> taps;
+        };
+
+        struct sum_reduction_t;
+
+        enum class counted_operator
+        {
+            transform, binary_op, select, select_axis, shift, freeze_axis, collect, concat,
+            replace, read_indexes, zip_arrays, cartesian_product, stencil, cache, permute_axes, count
+        };
+        struct stats_counters_t;
+        inline stats_counters_t& stats_counters();
+        inline void count_accesses(counted_operator op, std::size_t count);
+        class scoped_timer_t;
+
+        constexpr std::size_t row_block_size = 256;
+        constexpr std::size_t transpose_block_size = 32;
+
+        template<typename Provider, typename = void>
+        struct has_evaluate_row : std::false_type {};
+
+        template<typename Provider>
+        struct has_evaluate_row<Provider, std::void_t<decltype(std::declval<const Provider&>().evaluate_row(
+            std::declval<const index_t<Provider::rank>&>(),
+            std::declval<std::decay_t<typename Provider::value_type>*>(),
+            std::size_t()))>> : std::true_type {};
+
+        class mapped_file_t;
+        struct npy_header_t
+        {
+            std::string descr;
+            bool fortran_order = false;
+            std::vector<std::size_t> shape;
+            std::size_t data_offset = 0;
+        };
+        template<typename ValueType> std::string npy_descr();
+        template<std::size_t Rank> std::string make_npy_header(const std::string& descr, shape_t<Rank> shape);
+        inline npy_header_t read_npy_header(std::istream& stream);
+        template<typename ValueType, std::size_t Rank> shape_t<Rank> validate_npy_header(const npy_header_t& header);
+
+        template<typename Provider> struct is_row_major_memory_provider : std::false_type {};
+        template<std::size_t Rank, typename ValueType> struct is_row_major_memory_provider<unique_provider_t<Rank, ValueType>> : std::true_type {};
+        template<std::size_t Rank, typename ValueType> struct is_row_major_memory_provider<mmap_provider_t<Rank, ValueType>> : std::true_type {};
+        template<typename ValueType, std::size_t... Dims> struct is_row_major_memory_provider<static_provider_t<ValueType, Dims...>> : std::true_type {};
+
+        template<typename Provider> struct is_unique_provider : std::false_type {};
+        template<std::size_t Rank, typename ValueType> struct is_unique_provider<unique_provider_t<Rank, ValueType>> : std::true_type {};
+
+        template<typename Provider> struct is_mmap_provider : std::false_type {};
+        template<std::size_t Rank, typename ValueType> struct is_mmap_provider<mmap_provider_t<Rank, ValueType>> : std::true_type {};
+
+        template<typename Provider> struct is_strided_memory_provider : std::false_type {};
+        template<std::size_t Rank, typename ValueType> struct is_strided_memory_provider<view_provider_t<Rank, ValueType>> : std::true_type {};
+        template<std::size_t Rank, typename ValueType> struct is_strided_memory_provider<shared_provider_t<Rank, ValueType>> : std::true_type {};
+
+        template<typename Provider> struct is_uniform_provider : std::false_type {};
+        template<std::size_t Rank, typename ValueType> struct is_uniform_provider<uniform_provider_t<Rank, ValueType>> : std::true_type {};
+
+        template<typename Provider> struct is_block_sparse_provider : std::false_type {};
+        template<std::size_t Rank, typename ValueType> struct is_block_sparse_provider<block_sparse_provider_t<Rank, ValueType>> : std::true_type {};
+
+        template<typename Provider> struct is_zip_provider : std::false_type {};
+        template<typename... A, std::size_t R> struct is_zip_provider<basic_provider_t<zip_mapping_t<A...>, R>> : std::true_type {};
+
+        template<typename Provider> struct is_soa_provider : std::false_type {};
+        template<std::size_t Rank, typename... ValueTypes> struct is_soa_provider<soa_provider_t<Rank, ValueTypes...>> : std::true_type {};
+
+        template<typename Provider> struct is_elementwise_provider : std::false_type {};
+        template<typename A, typename F, std::size_t R> struct is_elementwise_provider<basic_provider_t<transform_mapping_t<A, F>, R>> : std::true_type {};
+        template<typename F, typename A, typename B, std::size_t R> struct is_elementwise_provider<basic_provider_t<binary_op_mapping_t<F, A, B>, R>> : std::true_type {};
+
+        template<typename T> struct is_array : std::false_type {};
+        template<typename Provider> struct is_array<array_t<Provider>> : std::true_type {};
+
+        template<typename T, typename = void> struct provider_of { using type = T; };
+        template<typename T> struct provider_of<T, std::void_t<typename T::provider_type>> { using type = typename T::provider_type; };
+        template<typename T> using provider_of_t = typename provider_of<std::decay_t<T>>::type;
     }
+
+
+    // provider traits; each accepts either a provider type or an array type
+    //=========================================================================
+    template<typename T> constexpr bool is_contiguous_v = detail::is_row_major_memory_provider<detail::provider_of_t<T>>::value;
+    template<typename T> constexpr bool is_strided_v = detail::is_strided_memory_provider<detail::provider_of_t<T>>::value;
+    template<typename T> constexpr bool is_memory_backed_v = is_contiguous_v<T> || is_strided_v<T>;
+    template<typename T> constexpr bool is_uniform_v = detail::is_uniform_provider<detail::provider_of_t<T>>::value;
+    template<typename T> constexpr bool is_block_sparse_v = detail::is_block_sparse_provider<detail::provider_of_t<T>>::value;
+    template<typename T> constexpr bool is_soa_v = detail::is_soa_provider<detail::provider_of_t<T>>::value;
+    template<typename T> constexpr bool is_elementwise_v = detail::is_elementwise_provider<detail::provider_of_t<T>>::value;
+    template<typename T> constexpr bool has_evaluate_row_v = detail::has_evaluate_row<detail::provider_of_t<T>>::value;
 }
 
 
@@ -441,41 +779,35 @@ public:
         return result;
     }
 
-    short_sequence_t()
-    {
-        for (auto n : range(Rank))
-        {
-            memory[n] = ValueType();
-        }
-    }
+    constexpr short_sequence_t() : memory() {}
 
-    short_sequence_t(std::initializer_list<ValueType> args)
+    constexpr short_sequence_t(std::initializer_list<ValueType> args) : memory()
     {
-        for (const auto& [n, a] : enumerate(args))
+        for (std::size_t n = 0; n < std::min(args.size(), Rank); ++n)
         {
-            memory[n] = a;
+            memory[n] = args.begin()[n];
         }
     }
 
-    bool operator==(const DerivedType& other) const
+    constexpr bool operator==(const DerivedType& other) const
     {
-        return all_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) == std::get<1>(t); });
+        return detail::all_elements(*this, other, std::equal_to<>(), std::make_index_sequence<Rank>());
     }
 
-    bool operator!=(const DerivedType& other) const
+    constexpr bool operator!=(const DerivedType& other) const
     {
-        return any_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) != std::get<1>(t); });
+        return ! operator==(other);
     }
 
     constexpr std::size_t size() const { return Rank; }
-    const ValueType* data() const { return memory; }
-    const ValueType* begin() const { return memory; }
-    const ValueType* end() const { return memory + Rank; }
-    const ValueType& operator[](std::size_t n) const { return memory[n]; }
-    ValueType* data() { return memory; }
-    ValueType* begin() { return memory; }
-    ValueType* end() { return memory + Rank; }
-    ValueType& operator[](std::size_t n) { return memory[n]; }
+    constexpr const ValueType* data() const { return memory; }
+    constexpr const ValueType* begin() const { return memory; }
+    constexpr const ValueType* end() const { return memory + Rank; }
+    constexpr const ValueType& operator[](std::size_t n) const { return memory[n]; }
+    constexpr ValueType* data() { return memory; }
+    constexpr ValueType* begin() { return memory; }
+    constexpr ValueType* end() { return memory + Rank; }
+    constexpr ValueType& operator[](std::size_t n) { return memory[n]; }
 
 private:
     //=========================================================================
@@ -505,7 +837,7 @@ public:
 
     bool contains(const index_t<Rank>& index) const
     {
-        return all_of(zip(index, *this), [] (const auto& t) { return std::get<0>(t) < std::get<1>(t); });
+        return detail::all_elements(index, *this, std::less<>(), std::make_index_sequence<Rank>());
     }
 
     template<typename... Args>
@@ -585,19 +917,19 @@ public:
 
     bool operator<(const index_t<Rank>& other) const
     {
-        return all_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) < std::get<1>(t); });
+        return detail::all_elements(*this, other, std::less<>(), std::make_index_sequence<Rank>());
     }
     bool operator>(const index_t<Rank>& other) const
     {
-        return all_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) > std::get<1>(t); });
+        return detail::all_elements(*this, other, std::greater<>(), std::make_index_sequence<Rank>());
     }
     bool operator<=(const index_t<Rank>& other) const
     {
-        return all_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) <= std::get<1>(t); });
+        return detail::all_elements(*this, other, std::less_equal<>(), std::make_index_sequence<Rank>());
     }
     bool operator>=(const index_t<Rank>& other) const
     {
-        return all_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) >= std::get<1>(t); });
+        return detail::all_elements(*this, other, std::greater_equal<>(), std::make_index_sequence<Rank>());
     }
 };
 
@@ -636,8 +968,7 @@ public:
 
     std::size_t compute_offset(const index_t<Rank>& index) const
     {
-        auto mul_tuple = [] (auto t) { return std::get<0>(t) * std::get<1>(t); };
-        return accumulate(zip(index, *this) | mul_tuple, 0, std::plus<>());
+        return detail::inner_product(index, *this, std::make_index_sequence<Rank>());
     }
 
     template<typename... Args>
@@ -645,6 +976,12 @@ public:
     {
         return compute_offset(make_index(args...));
     }
+
+    template<typename IndexContainer>
+    auto remove_elements(IndexContainer indexes) const
+    {
+        return detail::remove_elements<memory_strides_t<Rank - indexes.size()>>(*this, indexes);
+    }
 };
 
 
@@ -732,35 +1069,12 @@ public:
 
     bool advance(index_t<Rank>& index) const
     {
-        int n = Rank - 1;
-
-        index[n] += jumps[n];
-
-        while (index[n] >= final[n])
-        {
-            if (n == 0)
-            {
-                index = final;
-                return false;
-            }
-            index[n] = start[n];
-
-            --n;
-
-            index[n] += jumps[n];
-        }
-        return true;
+        return advance_axis<Rank - 1>(index);
     }
 
     index_t<Rank> map_index(const index_t<Rank>& index) const
     {
-        index_t<Rank> result;
-
-        for (std::size_t n = 0; n < Rank; ++n)
-        {
-            result[n] = start[n] + jumps[n] * index[n];
-        }
-        return result;
+        return map_index(index, std::make_index_sequence<Rank>());
     }
 
     index_t<Rank> inverse_map_index(const index_t<Rank>& mapped_index) const
@@ -826,6 +1140,46 @@ public:
                 t2 >= zero && t2 <= parent_shape.last_index());
     }
 
+    /**
+     * Return a sequence of access patterns that together generate the same
+     * indexes as this one, each generating at most tile_shape of them. The
+     * tiles are in row-major order of their starting indexes; iterating over
+     * each one in turn visits the index space in cache-sized blocks.
+     */
+    std::vector<access_pattern_t> tiled(shape_t<Rank> tile_shape) const
+    {
+        if (any_of(tile_shape, [] (auto s) { return s == 0; }))
+        {
+            throw std::logic_error("tiles must have a non-zero extent on each axis");
+        }
+        auto result = std::vector<access_pattern_t>();
+
+        if (empty())
+        {
+            return result;
+        }
+        auto tile_counts = shape_t<Rank>();
+
+        for (std::size_t n = 0; n < Rank; ++n)
+        {
+            auto extent = tile_shape[n] * jumps[n];
+            tile_counts[n] = (final[n] - start[n] + extent - 1) / extent;
+        }
+        for (const auto& tile_index : access_pattern_t().with_final(tile_counts.last_index()))
+        {
+            auto tile = *this;
+
+            for (std::size_t n = 0; n < Rank; ++n)
+            {
+                auto extent = tile_shape[n] * jumps[n];
+                tile.start[n] = start[n] + tile_index[n] * extent;
+                tile.final[n] = std::min(final[n], tile.start[n] + extent);
+            }
+            result.push_back(tile);
+        }
+        return result;
+    }
+
     iterator begin() const { return { *this, start }; }
     iterator end() const { return { *this, final }; }
 
@@ -833,6 +1187,39 @@ public:
     index_t<Rank> start = make_uniform_index<Rank>(0);
     index_t<Rank> final = make_uniform_index<Rank>(0);
     jumps_t<Rank> jumps = make_uniform_jumps<Rank>(1);
+
+private:
+    //=========================================================================
+    template<std::size_t Axis>
+    bool advance_axis(index_t<Rank>& index) const
+    {
+        // Steps the given axis, carrying into the axes before it; the
+        // recursion is resolved at compile time.
+        index[Axis] += jumps[Axis];
+
+        if (index[Axis] < final[Axis])
+        {
+            return true;
+        }
+        if constexpr (Axis == 0)
+        {
+            index = final;
+            return false;
+        }
+        else
+        {
+            index[Axis] = start[Axis];
+            return advance_axis<Axis - 1>(index);
+        }
+    }
+
+    template<std::size_t... Is>
+    index_t<Rank> map_index(const index_t<Rank>& index, std::index_sequence<Is...>) const
+    {
+        index_t<Rank> result;
+        ((result[Is] = start[Is] + jumps[Is] * index[Is]), ...);
+        return result;
+    }
 };
 
 
@@ -846,13 +1233,13 @@ public:
 
 
 template<typename... Args>
-auto nd::make_shape(Args... args)
+constexpr auto nd::make_shape(Args... args)
 {
     return shape_t<sizeof...(Args)>({std::size_t(args)...});
 }
 
 template<typename... Args>
-auto nd::make_index(Args... args)
+constexpr auto nd::make_index(Args... args)
 {
     return index_t<sizeof...(Args)>({std::size_t(args)...});
 }
@@ -898,6 +1285,20 @@ auto nd::make_strides_row_major(shape_t<Rank> shape)
     return result;
 }
 
+template<std::size_t Rank>
+auto nd::make_strides_column_major(shape_t<Rank> shape)
+{
+    auto result = memory_strides_t<Rank>();
+
+    result[0] = 1;
+
+    for (std::size_t n = 1; n < Rank; ++n)
+    {
+        result[n] = result[n - 1] * shape[n - 1];
+    }
+    return result;
+}
+
 template<std::size_t Rank>
 auto nd::make_access_pattern(shape_t<Rank> shape)
 {
@@ -913,1544 +1314,6295 @@ auto nd::make_access_pattern(Args... args)
 template<std::size_t NumPartitions, std::size_t Rank>
 auto nd::partition_shape(shape_t<Rank> shape)
 {
-    // Note: this function should handle remainders better
+    // Splits axis 0 into NumPartitions contiguous chunks, spreading the
+    // remainder over the leading chunks. Chunks may be empty if axis 0 is
+    // shorter than NumPartitions.
     constexpr std::size_t D = 0;
     auto result = basic_sequence_t<NumPartitions, access_pattern_t<Rank>>();
     auto chunk_size = shape[D] / NumPartitions;
+    auto remainder  = shape[D] % NumPartitions;
+    auto start = std::size_t(0);
 
     for (std::size_t n = 0; n < NumPartitions; ++n)
     {
         auto pattern = make_access_pattern(shape);
-        pattern.start[D] = chunk_size * n;
-        pattern.final[D] = n == NumPartitions - 1 ? shape[D] : chunk_size * (n + 1);
+        pattern.start[D] = start;
+        pattern.final[D] = start + chunk_size + (n < remainder ? 1 : 0);
+        start = pattern.final[D];
         result[n] = pattern;
     }
     return result;
 }
 
-
-
-
-//=============================================================================
-class nd::shifter_t
+template<std::size_t Rank>
+auto nd::partition_shape(shape_t<Rank> shape, std::size_t num_partitions)
 {
-public:
-
-    //=========================================================================
-    shifter_t(std::size_t axis_to_shift, int delta) : axis_to_shift(axis_to_shift), delta(delta) {}
+    // Splits axis 0 into at most num_partitions contiguous chunks, spreading
+    // the remainder over the leading chunks. Empty chunks are omitted, so the
+    // result may be shorter than num_partitions.
+    constexpr std::size_t D = 0;
+    auto result = std::vector<access_pattern_t<Rank>>();
+    auto num_chunks = std::min(num_partitions, shape[D]);
 
-    template<typename ArrayType>
-    auto operator()(ArrayType&& array) const
+    if (num_chunks == 0 || shape.volume() == 0)
     {
-        if (axis_to_shift >= rank(array))
-        {
-            throw std::logic_error("cannot shift axis greater than or equal to array rank");
-        }
-        if (std::size_t(std::abs(delta)) >= array.shape(axis_to_shift))
-        {
-            throw std::logic_error("cannot shift an array by more than its length on that axis");
-        }
-        auto mapping = [axis_to_shift=axis_to_shift, delta=delta, array] (auto index)
-        {
-            index[axis_to_shift] -= delta;
-            return array(index);
-        };
-        auto shape = array.shape();
-        shape[axis_to_shift] -= std::abs(delta);
-
-        return make_array(mapping, shape);
+        return result;
     }
+    auto chunk_size = shape[D] / num_chunks;
+    auto remainder  = shape[D] % num_chunks;
+    auto start = std::size_t(0);
 
-    auto along_axis(std::size_t new_axis_to_shift) const
+    for (std::size_t n = 0; n < num_chunks; ++n)
     {
-        return shifter_t(new_axis_to_shift, delta);
+        auto pattern = make_access_pattern(shape);
+        pattern.start[D] = start;
+        pattern.final[D] = start + chunk_size + (n < remainder ? 1 : 0);
+        start = pattern.final[D];
+        result.push_back(pattern);
     }
+    return result;
+}
 
-private:
-    //=========================================================================
-    std::size_t axis_to_shift;
-    int delta;
-};
-
-
-
-
-//=============================================================================
-class nd::axis_selector_t
+template<std::size_t Rank>
+auto nd::partition_tiles(shape_t<Rank> shape, std::size_t num_tiles)
 {
-public:
-
-    //=========================================================================
-    axis_selector_t(std::size_t axis_to_select, std::size_t start, std::size_t final, bool is_final_from_the_end)
-    : axis_to_select(axis_to_select)
-    , start(start)
-    , final(final)
-    , is_final_from_the_end(is_final_from_the_end) {}
-
-    template<typename ArrayType>
-    auto operator()(ArrayType&& array) const
+    // Splits the leading axes into near-equal chunks, moving on to the next
+    // axis only while there are fewer than num_tiles tiles, so that the rows
+    // of each tile stay as long as possible. The tiles are returned in
+    // row-major order; there may be somewhat more than num_tiles of them, or
+    // fewer if the shape has fewer elements.
+    auto result = std::vector<access_pattern_t<Rank>>();
+
+    if (num_tiles == 0 || shape.volume() == 0)
     {
-        if (axis_to_select >= rank(array))
-        {
-            throw std::logic_error("cannot select axis greater than or equal to array rank");
-        }
-        auto mapping = [axis_to_select=axis_to_select, start=start, array] (auto index)
-        {
-            index[axis_to_select] += start;
-            return array(index);
-        };
-
-        auto shape = array.shape();
-        shape[axis_to_select] -= start + (is_final_from_the_end ? final : (shape[axis_to_select] - final));
-
-        return make_array(mapping, shape);
+        return result;
     }
+    auto chunks = make_uniform_shape<Rank>(1);
+    auto count = std::size_t(1);
 
-    auto from(std::size_t new_start) const
-    {
-        return axis_selector_t(axis_to_select, new_start, final, is_final_from_the_end);
-    }
-    auto to(std::size_t new_final) const
+    for (std::size_t n = 0; n < Rank && count < num_tiles; ++n)
     {
-        return axis_selector_t(axis_to_select, start, new_final, is_final_from_the_end);
+        chunks[n] = std::min(shape[n], (num_tiles + count - 1) / count);
+        count *= chunks[n];
     }
-    auto from_the_end() const
+
+    for (const auto& chunk : make_access_pattern(chunks))
     {
-        return axis_selector_t(axis_to_select, start, final, true);        
-    }
+        auto tile = make_access_pattern(shape);
 
-private:
-    //=========================================================================
-    std::size_t axis_to_select;
-    std::size_t start;
-    std::size_t final;
-    bool is_final_from_the_end;
-};
+        for (std::size_t n = 0; n < Rank; ++n)
+        {
+            auto size = shape[n] / chunks[n];
+            auto remainder = shape[n] % chunks[n];
+            tile.start[n] = chunk[n] * size + std::min(chunk[n], remainder);
+            tile.final[n] = tile.start[n] + size + (chunk[n] < remainder ? 1 : 0);
+        }
+        result.push_back(tile);
+    }
+    return result;
+}
 
 
 
 
 //=============================================================================
-template<std::size_t Rank>
-class nd::selector_t
+class nd::thread_pool_t
 {
 public:
 
     //=========================================================================
-    selector_t(access_pattern_t<Rank> region=access_pattern_t<Rank>()) : region(region) {}
-
-    template<typename ArrayType>
-    auto operator()(ArrayType&& array) const
+    thread_pool_t(std::size_t num_threads=std::thread::hardware_concurrency())
     {
-        if (! region.within(array.shape()))
+        for (std::size_t n = 0; n < num_threads; ++n)
         {
-            throw std::logic_error("out-of-bounds selection");
+            workers.emplace_back([this] { work(); });
         }
-        auto mapping = [region=region, array] (auto&& index) { return array(region.map_index(index)); };
-        return make_array(basic_provider_t<decltype(mapping), Rank>(mapping, region.shape()));
     }
 
-    template<typename... Args> auto from   (Args... args) const { return from   (make_index(args...)); }
-    template<typename... Args> auto to     (Args... args) const { return to     (make_index(args...)); }
-    template<typename... Args> auto jumping(Args... args) const { return jumping(make_jumps(args...)); }
-    auto from   (index_t<Rank> arg) const { return selector_t(region.with_start(arg)); }
-    auto to     (index_t<Rank> arg) const { return selector_t(region.with_final(arg)); }
-    auto jumping(jumps_t<Rank> arg) const { return selector_t(region.with_jumps(arg)); }
+    ~thread_pool_t()
+    {
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
 
-private:
-    //=========================================================================
-    access_pattern_t<Rank> region;
-};
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
 
+    thread_pool_t(const thread_pool_t& other) = delete;
+    thread_pool_t& operator=(const thread_pool_t& other) = delete;
 
+    /**
+     * Return the number of worker threads. A pool of size zero executes all
+     * of its tasks on the calling thread.
+     */
+    std::size_t size() const { return workers.size(); }
 
+    /**
+     * Call fn(n) for each n in [0, num_tasks), distributing the calls over the
+     * worker threads. Each participating thread claims the next unclaimed n
+     * whenever it finishes a call, so threads that draw cheap tasks go on to
+     * take more of them. This function blocks until all of the calls have
+     * returned. The calling thread takes part in the loop, and then waits
+     * only for calls already claimed by other threads, so it is safe to call
+     * from inside another task. The first exception thrown by any of the
+     * calls is re-thrown here.
+     */
+    template<typename Function>
+    void parallel_for(std::size_t num_tasks, Function&& fn)
+    {
+        if (workers.empty() || num_tasks <= 1)
+        {
+            for (std::size_t n = 0; n < num_tasks; ++n)
+            {
+                fn(n);
+            }
+            return;
+        }
+        auto loop = std::make_shared<loop_state_t>();
+        loop->num_tasks = num_tasks;
 
-//=============================================================================
-template<std::size_t Rank, typename ArrayType>
-class nd::replacer_t
-{
-public:
+        // Runners that only start after the loop is finished claim nothing,
+        // and never touch fn; those still queued when this function returns
+        // are harmless.
+        auto run_claimed_tasks = [loop, function=&fn]
+        {
+            for (auto n = loop->next++; n < loop->num_tasks; n = loop->next++)
+            {
+                try {
+                    (*function)(n);
+                }
+                catch (...)
+                {
+                    auto lock = std::lock_guard<std::mutex>(loop->mutex);
+
+                    if (! loop->error)
+                    {
+                        loop->error = std::current_exception();
+                    }
+                }
+                if (++loop->completed == loop->num_tasks)
+                {
+                    auto lock = std::lock_guard<std::mutex>(loop->mutex);
+                    loop->condition.notify_all();
+                }
+            }
+        };
 
-    //=========================================================================
-    replacer_t(access_pattern_t<Rank> region=access_pattern_t<Rank>()) : region(region) {}
-    replacer_t(access_pattern_t<Rank> region, ArrayType replacement_array)
-    : region(region)
-    , replacement_array(replacement_array) {}
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex);
 
-    template<typename PatchArrayType>
-    auto operator()(PatchArrayType&& array_to_patch) const
+            for (std::size_t n = 0; n < std::min(num_tasks - 1, workers.size()); ++n)
+            {
+                tasks.push_back(run_claimed_tasks);
+            }
+        }
+        condition.notify_all();
+        run_claimed_tasks();
+
+        {
+            auto lock = std::unique_lock<std::mutex>(loop->mutex);
+            loop->condition.wait(lock, [&] { return loop->completed == num_tasks; });
+        }
+        if (loop->error)
+        {
+            std::rethrow_exception(loop->error);
+        }
+    }
+
+    /**
+     * Queue a call to fn() on a worker thread, and return a future of its
+     * result; an exception thrown by fn is stored in the future. A pool of
+     * size zero calls fn immediately.
+     */
+    template<typename Function>
+    auto submit(Function&& fn)
     {
-        if (region.shape() != replacement_array.shape())
+        using result_type = std::invoke_result_t<std::decay_t<Function>&>;
+        auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<Function>(fn));
+        auto future = task->get_future();
+
+        if (workers.empty())
         {
-            throw std::logic_error("region to replace has a different shape than the replacement array");
+            (*task)();
+            return future;
+        }
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex);
+            tasks.push_back([this, task] { (*task)(); release_continuations(); });
+        }
+        condition.notify_all();
+        return future;
+    }
+
+    /**
+     * Like submit, but the call to fn() is only queued once the given future
+     * is ready, so no thread is blocked waiting on it. The future should be
+     * one made ready by a task of this pool (or one that is ready already),
+     * since the pool checks on its continuations as each of its own tasks
+     * completes. A pool of size zero waits for the future and then calls fn
+     * immediately.
+     */
+    template<typename FutureType, typename Function>
+    auto submit_after(FutureType future, Function&& fn)
+    {
+        using result_type = std::invoke_result_t<std::decay_t<Function>&>;
+        auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<Function>(fn));
+        auto result = task->get_future();
+
+        if (workers.empty())
+        {
+            future.wait();
+            (*task)();
+            return result;
         }
+        auto run = std::function<void()>([this, task] { (*task)(); release_continuations(); });
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex);
+
+            if (is_ready(future))
+            {
+                tasks.push_back(std::move(run));
+            }
+            else
+            {
+                continuations.push_back({[future] { return is_ready(future); }, std::move(run)});
+                return result;
+            }
+        }
+        condition.notify_all();
+        return result;
+    }
 
-        auto mapping = [region=region, replacement_array=replacement_array, array_to_patch] (auto&& index)
+    /**
+     * Return the value of a future (std::future or std::shared_future) once
+     * it is ready, executing queued tasks while it is not. The future should
+     * be one made ready by a task of this pool (or one that is ready
+     * already): when there is nothing to run, this sleeps until a task of the
+     * pool completes or a task is queued, so that continuations released in
+     * the meantime still get a thread. This may be called from inside a
+     * task, but tasks that wait this way should not be chained on each
+     * other; use submit_after (or nd::then) for that.
+     */
+    template<typename FutureType>
+    decltype(auto) wait(FutureType& future)
+    {
+        while (! is_ready(future))
         {
-            if (region.generates(index))
+            if (! run_pending_task())
             {
-                return replacement_array(region.inverse_map_index(index));
+                auto lock = std::unique_lock<std::mutex>(mutex);
+                condition.wait(lock, [this, &future] { return is_ready(future) || ! tasks.empty(); });
             }
-            return array_to_patch(index);
-        };
-        return make_array(mapping, array_to_patch.shape());
+        }
+        return future.get();
     }
 
-    template<typename... Args> auto from   (Args... args) const { return from   (make_index(args...)); }
-    template<typename... Args> auto to     (Args... args) const { return to     (make_index(args...)); }
-    template<typename... Args> auto jumping(Args... args) const { return jumping(make_jumps(args...)); }
-    auto from   (index_t<Rank> arg) const { return replacer_t(region.with_start(arg), replacement_array); }
-    auto to     (index_t<Rank> arg) const { return replacer_t(region.with_final(arg), replacement_array); }
-    auto jumping(jumps_t<Rank> arg) const { return replacer_t(region.with_jumps(arg), replacement_array); }
+private:
+    //=========================================================================
+    struct loop_state_t
+    {
+        std::atomic<std::size_t> next = {0};
+        std::atomic<std::size_t> completed = {0};
+        std::size_t num_tasks = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
 
-    template<typename OtherArrayType>
-    auto with(OtherArrayType&& new_replacement_array) const
+    struct continuation_t
+    {
+        std::function<bool()> ready;
+        std::function<void()> run;
+    };
+
+    template<typename FutureType>
+    static bool is_ready(const FutureType& future)
     {
-        return replacer_t<Rank, OtherArrayType>(region, std::forward<OtherArrayType>(new_replacement_array));
+        return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    void release_continuations()
+    {
+        // Called as each task completes, after its future is made ready. The
+        // notification is unconditional, since threads in wait() may be
+        // sleeping on that future rather than on the queue.
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex);
+
+            for (auto c = continuations.begin(); c != continuations.end();)
+            {
+                if (c->ready())
+                {
+                    tasks.push_back(std::move(c->run));
+                    c = continuations.erase(c);
+                }
+                else
+                {
+                    ++c;
+                }
+            }
+        }
+        condition.notify_all();
+    }
+
+    bool run_pending_task()
+    {
+        auto task = std::function<void()>();
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex);
+
+            if (tasks.empty())
+            {
+                return false;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+        return true;
+    }
+
+    void work()
+    {
+        while (true)
+        {
+            auto task = std::function<void()>();
+            {
+                auto lock = std::unique_lock<std::mutex>(mutex);
+                condition.wait(lock, [this] { return stopping || ! tasks.empty(); });
+
+                if (tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
     }
 
-private:
     //=========================================================================
-    access_pattern_t<Rank> region;
-    ArrayType replacement_array;
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::vector<continuation_t> continuations;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
 };
 
 
 
 
 //=============================================================================
-template<std::size_t RankDifference>
-class nd::axis_freezer_t
+template<typename ValueType, std::size_t Width>
+class nd::simd_pack_t
 {
 public:
 
-    //=========================================================================
-    axis_freezer_t(
-        index_t<RankDifference> axes_to_freeze,
-        index_t<RankDifference> index_to_freeze_at=make_uniform_index<RankDifference>(0))
-    : axes_to_freeze(axes_to_freeze)
-    , index_to_freeze_at(index_to_freeze_at) {}
+    using value_type = ValueType;
+    static constexpr std::size_t width = Width;
 
-    template<typename PatchArrayType>
-    auto operator()(PatchArrayType array) const
+    //=========================================================================
+    static simd_pack_t broadcast(ValueType value)
     {
-        if (any_of(axes_to_freeze, [array] (auto a) { return a >= rank(array); }))
+        auto result = simd_pack_t();
+
+        for (std::size_t n = 0; n < Width; ++n)
         {
-            throw std::logic_error("cannot freeze axis greater than or equal to array rank");
+            result.lanes[n] = value;
         }
-        auto mapping = [axes_to_freeze=axes_to_freeze, index_to_freeze_at=index_to_freeze_at, array] (auto&& index)
-        {
-            return array(index.insert_elements(axes_to_freeze, index_to_freeze_at));
-        };
-        auto shape = array.shape().remove_elements(axes_to_freeze);
+        return result;
+    }
 
-        return make_array(mapping, shape);
+    static simd_pack_t load(const ValueType* source)
+    {
+        auto result = simd_pack_t();
+        std::memcpy(&result.lanes, source, sizeof(result.lanes));
+        return result;
     }
 
-    auto at_index(index_t<RankDifference> new_index_to_freeze_at) const
+    void store(ValueType* target) const
     {
-        return axis_freezer_t(axes_to_freeze, new_index_to_freeze_at);
+        std::memcpy(target, &lanes, sizeof(lanes));
     }
 
-    template<typename... Args>
-    auto at_index(Args... new_index_to_freeze_at) const
+    ValueType operator[](std::size_t n) const { return lanes[n]; }
+
+    simd_pack_t operator-() const
     {
-        static_assert(sizeof...(Args) == RankDifference);
-        return at_index(make_index(new_index_to_freeze_at...));
+        // A true negation, rather than 0 - x, so that the sign of zero flips
+        // just as it does for scalars.
+        auto result = simd_pack_t();
+#if defined(__GNUC__)
+        result.lanes = -lanes;
+#else
+        for (std::size_t n = 0; n < Width; ++n)
+        {
+            result.lanes[n] = -lanes[n];
+        }
+#endif
+        return result;
     }
 
+    friend simd_pack_t operator+(const simd_pack_t& a, const simd_pack_t& b) { return zip_with(a, b, std::plus<>()); }
+    friend simd_pack_t operator-(const simd_pack_t& a, const simd_pack_t& b) { return zip_with(a, b, std::minus<>()); }
+    friend simd_pack_t operator*(const simd_pack_t& a, const simd_pack_t& b) { return zip_with(a, b, std::multiplies<>()); }
+    friend simd_pack_t operator/(const simd_pack_t& a, const simd_pack_t& b) { return zip_with(a, b, std::divides<>()); }
+
+    template<typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> friend simd_pack_t operator+(const simd_pack_t& a, S b) { return a + broadcast(b); }
+    template<typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> friend simd_pack_t operator-(const simd_pack_t& a, S b) { return a - broadcast(b); }
+    template<typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> friend simd_pack_t operator*(const simd_pack_t& a, S b) { return a * broadcast(b); }
+    template<typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> friend simd_pack_t operator/(const simd_pack_t& a, S b) { return a / broadcast(b); }
+    template<typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> friend simd_pack_t operator+(S a, const simd_pack_t& b) { return broadcast(a) + b; }
+    template<typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> friend simd_pack_t operator-(S a, const simd_pack_t& b) { return broadcast(a) - b; }
+    template<typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> friend simd_pack_t operator*(S a, const simd_pack_t& b) { return broadcast(a) * b; }
+    template<typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> friend simd_pack_t operator/(S a, const simd_pack_t& b) { return broadcast(a) / b; }
+
 private:
     //=========================================================================
-    index_t<RankDifference> axes_to_freeze;
-    index_t<RankDifference> index_to_freeze_at;
+    template<typename Function>
+    static simd_pack_t zip_with(const simd_pack_t& a, const simd_pack_t& b, Function&& fn)
+    {
+        auto result = simd_pack_t();
+#if defined(__GNUC__)
+        result.lanes = fn(a.lanes, b.lanes);
+#else
+        for (std::size_t n = 0; n < Width; ++n)
+        {
+            result.lanes[n] = fn(a.lanes[n], b.lanes[n]);
+        }
+#endif
+        return result;
+    }
+
+    //=========================================================================
+#if defined(__GNUC__)
+    typedef ValueType native_type __attribute__((vector_size(sizeof(ValueType) * Width)));
+    native_type lanes;
+#else
+    alignas(sizeof(ValueType) * Width) ValueType lanes[Width];
+#endif
 };
 
 
 
 
+
+
+
 //=============================================================================
-template<typename OperatorType>
-class nd::axis_reducer_t
+class nd::shifter_t
 {
 public:
 
     //=========================================================================
-    axis_reducer_t(std::size_t axis_to_reduce, OperatorType the_operator)
-    : axis_to_reduce(axis_to_reduce)
-    , the_operator(the_operator) {}
+    shifter_t(std::size_t axis_to_shift, int delta) : axis_to_shift(axis_to_shift), delta(delta) {}
 
     template<typename ArrayType>
-    auto operator()(ArrayType array) const
+    auto operator()(ArrayType&& array) const
     {
-        if (axis_to_reduce >= rank(array))
+        if (axis_to_shift >= rank(array))
         {
-            throw std::logic_error("cannot reduce axis greater than or equal to array rank");
+            throw std::logic_error("cannot shift axis greater than or equal to array rank");
         }
-        constexpr std::size_t R = ArrayType::rank;
+        if (std::size_t(std::abs(delta)) >= array.shape(axis_to_shift))
+        {
+            throw std::logic_error("cannot shift an array by more than its length on that axis");
+        }
+        using provider_type = typename std::decay_t<ArrayType>::provider_type;
 
-        auto mapping = [the_operator=the_operator, axis_to_reduce=axis_to_reduce, array] (auto&& index)
+        if constexpr (detail::is_strided_memory_provider<provider_type>::value)
         {
-            auto axes_to_freeze = index_t<R>::from_range(range(R)).remove_elements(make_index(axis_to_reduce));
-            auto freezer = axis_freezer_t<R - 1>(axes_to_freeze).at_index(index.read_elements(axes_to_freeze));
-            return the_operator(freezer(array));
-        };
-        auto shape = array.shape().remove_elements(make_index(axis_to_reduce));
+            auto shape = array.shape();
+            auto strides = array.get_provider().strides();
+            shape[axis_to_shift] -= std::abs(delta);
+
+            // For a positive delta the offset wraps around; the view then has
+            // no data pointer, and its leading elements are not readable.
+            return make_array(array.get_provider().with_layout(shape, strides, std::size_t(-std::ptrdiff_t(delta)) * strides[axis_to_shift]));
+        }
+        else
+        {
+            auto shape = array.shape();
+            shape[axis_to_shift] -= std::abs(delta);
 
-        return make_array(mapping, shape);
+            auto mapping = [axis_to_shift=axis_to_shift, delta=delta, array=std::forward<ArrayType>(array)] (auto index)
+            {
+                NDARRAY_STATS_ACCESS(shift, 1);
+                index[axis_to_shift] -= delta;
+                return array(index);
+            };
+            return make_array(std::move(mapping), shape);
+        }
     }
 
-    auto along_axis(std::size_t new_axis_to_reduce) const
+    auto along_axis(std::size_t new_axis_to_shift) const
     {
-        return axis_reducer_t(new_axis_to_reduce, the_operator);
+        return shifter_t(new_axis_to_shift, delta);
     }
 
 private:
     //=========================================================================
-    std::size_t axis_to_reduce;
-    OperatorType the_operator;
+    std::size_t axis_to_shift;
+    int delta;
 };
 
 
 
 
 //=============================================================================
-template<typename ArrayType>
-class nd::concatenator_t
+class nd::axis_selector_t
 {
 public:
 
     //=========================================================================
-    concatenator_t(std::size_t axis_to_extend, ArrayType array_to_concat)
-    : axis_to_extend(axis_to_extend)
-    , array_to_concat(array_to_concat) {}
+    axis_selector_t(std::size_t axis_to_select, std::size_t start, std::size_t final, bool is_final_from_the_end)
+    : axis_to_select(axis_to_select)
+    , start(start)
+    , final(final)
+    , is_final_from_the_end(is_final_from_the_end) {}
 
-    template<typename SourceArrayType>
-    auto operator()(SourceArrayType array) const
+    template<typename ArrayType>
+    auto operator()(ArrayType&& array) const
     {
-        if (axis_to_extend >= rank(array))
+        if (axis_to_select >= rank(array))
         {
-            throw std::logic_error("cannot concatenate on axis greater than or equal to array rank");
+            throw std::logic_error("cannot select axis greater than or equal to array rank");
         }
-        if (array_to_concat.shape().remove_elements(make_index(axis_to_extend))
-            !=        array.shape().remove_elements(make_index(axis_to_extend)))
+        using provider_type = typename std::decay_t<ArrayType>::provider_type;
+
+        auto shape = array.shape();
+        shape[axis_to_select] -= start + (is_final_from_the_end ? final : (shape[axis_to_select] - final));
+
+        if constexpr (detail::is_strided_memory_provider<provider_type>::value)
         {
-            throw std::logic_error("the shape of the concatenated arrays can only differ on the concatenating axis");
+            auto strides = array.get_provider().strides();
+            return make_array(array.get_provider().with_layout(shape, strides, start * strides[axis_to_select]));
         }
-
-        auto mapping = [axis_to_extend=axis_to_extend, array_to_concat=array_to_concat, array] (auto index)
+        else
         {
-            if (index[axis_to_extend] >= array.shape(axis_to_extend))
+            auto mapping = [axis_to_select=axis_to_select, start=start, array=std::forward<ArrayType>(array)] (auto index)
             {
-                index[axis_to_extend] -= array.shape(axis_to_extend);
-                return array_to_concat(index);
-            }
-            return array(index);
-        };
-
-        auto shape = array.shape();
-        shape[axis_to_extend] += array_to_concat.shape(axis_to_extend);
-
-        return make_array(mapping, shape);
+                NDARRAY_STATS_ACCESS(select_axis, 1);
+                index[axis_to_select] += start;
+                return array(index);
+            };
+            return make_array(std::move(mapping), shape);
+        }
     }
 
-    auto on_axis(std::size_t new_axis_to_concat) const
+    auto from(std::size_t new_start) const
     {
-        return concatenator_t(new_axis_to_concat, array_to_concat);
+        return axis_selector_t(axis_to_select, new_start, final, is_final_from_the_end);
+    }
+    auto to(std::size_t new_final) const
+    {
+        return axis_selector_t(axis_to_select, start, new_final, is_final_from_the_end);
+    }
+    auto from_the_end() const
+    {
+        return axis_selector_t(axis_to_select, start, final, true);        
     }
 
 private:
     //=========================================================================
-    std::size_t axis_to_extend;
-    ArrayType array_to_concat;
+    std::size_t axis_to_select;
+    std::size_t start;
+    std::size_t final;
+    bool is_final_from_the_end;
 };
 
 
 
 
 //=============================================================================
-template<typename Function, std::size_t Rank>
-class nd::basic_provider_t
+template<std::size_t Rank>
+class nd::selector_t
 {
 public:
 
-    using value_type = std::invoke_result_t<Function, index_t<Rank>>;
-    static constexpr std::size_t rank = Rank;
-
     //=========================================================================
-    basic_provider_t(Function mapping, shape_t<Rank> the_shape) : mapping(mapping), the_shape(the_shape) {}
-    decltype(auto) operator()(const index_t<Rank>& index) const { return mapping(index); }
-    auto shape() const { return the_shape; }
-    auto size() const { return the_shape.volume(); }
+    selector_t(access_pattern_t<Rank> region=access_pattern_t<Rank>()) : region(region) {}
 
-    template<std::size_t R> auto reshape(shape_t<R>) const
+    template<typename ArrayType>
+    auto operator()(ArrayType&& array) const
     {
-        throw std::logic_error("array provider cannot be reshaped");
+        if (! region.within(array.shape()))
+        {
+            throw std::logic_error("out-of-bounds selection");
+        }
+        using provider_type = typename std::decay_t<ArrayType>::provider_type;
+
+        if constexpr (detail::is_strided_memory_provider<provider_type>::value)
+        {
+            auto strides = array.get_provider().strides();
+            auto offset = strides.compute_offset(region.start);
+
+            for (std::size_t n = 0; n < Rank; ++n)
+            {
+                strides[n] *= region.jumps[n];
+            }
+            return make_array(array.get_provider().with_layout(region.shape(), strides, offset));
+        }
+        else
+        {
+            auto mapping = [region=region, array=std::forward<ArrayType>(array)] (auto&& index)
+            {
+                NDARRAY_STATS_ACCESS(select, 1);
+                return array(region.map_index(index));
+            };
+            return make_array(basic_provider_t<decltype(mapping), Rank>(std::move(mapping), region.shape()));
+        }
     }
 
+    template<typename... Args> auto from   (Args... args) const { return from   (make_index(args...)); }
+    template<typename... Args> auto to     (Args... args) const { return to     (make_index(args...)); }
+    template<typename... Args> auto jumping(Args... args) const { return jumping(make_jumps(args...)); }
+    auto from   (index_t<Rank> arg) const { return selector_t(region.with_start(arg)); }
+    auto to     (index_t<Rank> arg) const { return selector_t(region.with_final(arg)); }
+    auto jumping(jumps_t<Rank> arg) const { return selector_t(region.with_jumps(arg)); }
+
 private:
     //=========================================================================
-    Function mapping;
-    shape_t<Rank> the_shape;
+    access_pattern_t<Rank> region;
 };
 
 
 
 
 //=============================================================================
-template<std::size_t Rank, typename ValueType>
-class nd::shared_provider_t
+template<std::size_t Rank, typename ArrayType>
+class nd::replacer_t
 {
 public:
 
-    using value_type = ValueType;
-    static constexpr std::size_t rank = Rank;
-
     //=========================================================================
-    shared_provider_t(nd::shape_t<Rank> the_shape, std::shared_ptr<nd::buffer_t<ValueType>> buffer)
-    : the_shape(the_shape)
-    , strides(make_strides_row_major(the_shape))
-    , buffer(buffer)
+    replacer_t(access_pattern_t<Rank> region=access_pattern_t<Rank>()) : region(region) {}
+    replacer_t(access_pattern_t<Rank> region, ArrayType replacement_array)
+    : region(region)
+    , replacement_array(std::move(replacement_array)) {}
+
+    template<typename PatchArrayType>
+    auto operator()(PatchArrayType&& array_to_patch) const &
     {
-        if (the_shape.volume() != buffer->size())
-        {
-            throw std::logic_error("shape and buffer sizes do not match");
-        }
+        return patch(region, replacement_array, std::forward<PatchArrayType>(array_to_patch));
     }
 
-    const ValueType& operator()(const index_t<Rank>& index) const
+    template<typename PatchArrayType>
+    auto operator()(PatchArrayType&& array_to_patch) &&
     {
-        return buffer->operator[](strides.compute_offset(index));
+        return patch(region, std::move(replacement_array), std::forward<PatchArrayType>(array_to_patch));
     }
 
-    auto shape() const { return the_shape; }
-    auto size() const { return the_shape.volume(); }
-    const ValueType* data() const { return buffer->data(); }
-    template<std::size_t R> auto reshape(shape_t<R> new_shape) const { return shared_provider_t<R, ValueType>(new_shape, buffer); }
+    template<typename... Args> auto from   (Args... args) const { return from   (make_index(args...)); }
+    template<typename... Args> auto to     (Args... args) const { return to     (make_index(args...)); }
+    template<typename... Args> auto jumping(Args... args) const { return jumping(make_jumps(args...)); }
+    auto from   (index_t<Rank> arg) const { return replacer_t(region.with_start(arg), replacement_array); }
+    auto to     (index_t<Rank> arg) const { return replacer_t(region.with_final(arg), replacement_array); }
+    auto jumping(jumps_t<Rank> arg) const { return replacer_t(region.with_jumps(arg), replacement_array); }
+
+    template<typename OtherArrayType>
+    auto with(OtherArrayType&& new_replacement_array) const
+    {
+        return replacer_t<Rank, std::decay_t<OtherArrayType>>(region, std::forward<OtherArrayType>(new_replacement_array));
+    }
 
 private:
     //=========================================================================
-    shape_t<Rank> the_shape;
-    memory_strides_t<Rank> strides;
-    std::shared_ptr<buffer_t<ValueType>> buffer;
+    template<typename ReplacementArrayType, typename PatchArrayType>
+    static auto patch(access_pattern_t<Rank> region, ReplacementArrayType&& replacement_array, PatchArrayType&& array_to_patch)
+    {
+        if (region.shape() != replacement_array.shape())
+        {
+            throw std::logic_error("region to replace has a different shape than the replacement array");
+        }
+        using mapping_type = detail::replace_mapping_t<Rank, std::decay_t<ReplacementArrayType>, std::decay_t<PatchArrayType>>;
+        auto shape = array_to_patch.shape();
+
+        return make_array(mapping_type(region, std::forward<ReplacementArrayType>(replacement_array), std::forward<PatchArrayType>(array_to_patch)), shape);
+    }
+
+    access_pattern_t<Rank> region;
+    ArrayType replacement_array;
 };
 
 
 
 
 //=============================================================================
-template<std::size_t Rank, typename ValueType>
-class nd::unique_provider_t
+template<std::size_t RankDifference>
+class nd::axis_freezer_t
 {
 public:
 
-    using value_type = ValueType;
-    static constexpr std::size_t rank = Rank;
-
     //=========================================================================
-    unique_provider_t(nd::shape_t<Rank> the_shape, nd::buffer_t<ValueType>&& buffer)
-    : the_shape(the_shape)
-    , strides(make_strides_row_major(the_shape))
-    , buffer(std::move(buffer))
+    axis_freezer_t(
+        index_t<RankDifference> axes_to_freeze,
+        index_t<RankDifference> index_to_freeze_at=make_uniform_index<RankDifference>(0))
+    : axes_to_freeze(axes_to_freeze)
+    , index_to_freeze_at(index_to_freeze_at) {}
+
+    template<typename PatchArrayType>
+    auto operator()(PatchArrayType&& array) const
     {
-        if (the_shape.volume() != unique_provider_t::buffer.size())
+        if (any_of(axes_to_freeze, [&array] (auto a) { return a >= rank(array); }))
         {
-            throw std::logic_error("shape and buffer sizes do not match");
+            throw std::logic_error("cannot freeze axis greater than or equal to array rank");
         }
-    }
+        using provider_type = typename std::decay_t<PatchArrayType>::provider_type;
 
-    const ValueType& operator()(const index_t<Rank>& index) const { return buffer.operator[](strides.compute_offset(index)); }
-    /* */ ValueType& operator()(const index_t<Rank>& index)       { return buffer.operator[](strides.compute_offset(index)); }
-    template<typename... Args> const ValueType& operator()(Args... args) const { return operator()(make_index(args...)); }
-    template<typename... Args> /* */ ValueType& operator()(Args... args)       { return operator()(make_index(args...)); }
+        auto shape = array.shape().remove_elements(axes_to_freeze);
 
-    auto shape() const { return the_shape; }
-    auto size() const { return the_shape.volume(); }
-    const ValueType* data() const { return buffer.data(); }
-    ValueType* data() { return buffer.data(); }
+        if constexpr (detail::is_strided_memory_provider<provider_type>::value)
+        {
+            auto strides = array.get_provider().strides();
+            auto offset = std::size_t(0);
 
-    auto shared() const & { return shared_provider_t(the_shape, std::make_shared<buffer_t<ValueType>>(buffer.begin(), buffer.end())); }
-    auto shared()      && { return shared_provider_t(the_shape, std::make_shared<buffer_t<ValueType>>(std::move(buffer))); }
+            for (std::size_t n = 0; n < RankDifference; ++n)
+            {
+                offset += index_to_freeze_at[n] * strides[axes_to_freeze[n]];
+            }
+            return make_array(array.get_provider().with_layout(shape, strides.remove_elements(axes_to_freeze), offset));
+        }
+        else
+        {
+            auto mapping = [
+                axes_to_freeze=axes_to_freeze,
+                index_to_freeze_at=index_to_freeze_at,
+                array=std::forward<PatchArrayType>(array)] (auto&& index)
+            {
+                NDARRAY_STATS_ACCESS(freeze_axis, 1);
+                return array(index.insert_elements(axes_to_freeze, index_to_freeze_at));
+            };
+            return make_array(std::move(mapping), shape);
+        }
+    }
 
-    template<std::size_t R> auto reshape(shape_t<R> new_shape) const & { return unique_provider_t<R, ValueType>(new_shape, buffer_t<ValueType>(buffer.begin(), buffer.end())); }
-    template<std::size_t R> auto reshape(shape_t<R> new_shape)      && { return unique_provider_t<R, ValueType>(new_shape, std::move(buffer)); }
+    auto at_index(index_t<RankDifference> new_index_to_freeze_at) const
+    {
+        return axis_freezer_t(axes_to_freeze, new_index_to_freeze_at);
+    }
+
+    template<typename... Args>
+    auto at_index(Args... new_index_to_freeze_at) const
+    {
+        static_assert(sizeof...(Args) == RankDifference);
+        return at_index(make_index(new_index_to_freeze_at...));
+    }
 
 private:
     //=========================================================================
-    shape_t<Rank> the_shape;
-    memory_strides_t<Rank> strides;
-    buffer_t<ValueType> buffer;
+    index_t<RankDifference> axes_to_freeze;
+    index_t<RankDifference> index_to_freeze_at;
 };
 
 
 
 
 //=============================================================================
-template<std::size_t Rank, typename ValueType>
-class nd::uniform_provider_t
+template<typename OperatorType>
+class nd::axis_reducer_t
 {
 public:
 
-    using value_type = ValueType;
-    static constexpr std::size_t rank = Rank;
-
     //=========================================================================
-    uniform_provider_t(shape_t<Rank> the_shape, ValueType the_value) : the_shape(the_shape), the_value(the_value) {}
-    const ValueType& operator()(const index_t<Rank>&) const { return the_value; }
-    auto shape() const { return the_shape; }
-    auto size() const { return the_shape.volume(); }
-    template<std::size_t NewRank> auto reshape(shape_t<NewRank> new_shape) const { return uniform_provider_t<NewRank, ValueType>(new_shape, the_value); }
+    axis_reducer_t(std::size_t axis_to_reduce, OperatorType the_operator)
+    : axis_to_reduce(axis_to_reduce)
+    , the_operator(the_operator) {}
+
+    template<typename ArrayType>
+    auto operator()(ArrayType array) const
+    {
+        if (axis_to_reduce >= rank(array))
+        {
+            throw std::logic_error("cannot reduce axis greater than or equal to array rank");
+        }
+        constexpr std::size_t R = ArrayType::rank;
+
+        auto shape = array.shape().remove_elements(make_index(axis_to_reduce));
+
+        if constexpr (std::is_same<OperatorType, detail::sum_reduction_t>::value && R > 1)
+        {
+            return make_array(detail::axis_sum_mapping_t<ArrayType>(std::move(array), axis_to_reduce), shape);
+        }
+        else
+        {
+            auto operand = std::make_shared<const ArrayType>(std::move(array));
+            auto mapping = [the_operator=the_operator, axis_to_reduce=axis_to_reduce, operand] (auto&& index)
+            {
+                NDARRAY_STATS_ACCESS(collect, 1);
+
+                if constexpr (detail::is_strided_memory_provider<typename ArrayType::provider_type>::value)
+                {
+                    auto axes_to_freeze = index_t<R>::from_range(range(R)).remove_elements(make_index(axis_to_reduce));
+                    auto freezer = axis_freezer_t<R - 1>(axes_to_freeze).at_index(index);
+                    return the_operator(freezer(*operand));
+                }
+                else
+                {
+                    // The line being reduced refers to the array held by this
+                    // mapping, rather than copying it for each element. If the
+                    // operator returns an array (which may refer to the line),
+                    // the line shares ownership of the array so that it
+                    // outlives this mapping.
+                    auto start = index.insert_elements(make_index(axis_to_reduce), make_index(0));
+                    auto make_line = [start, axis_to_reduce=axis_to_reduce, n=operand->shape(axis_to_reduce)] (auto holder)
+                    {
+                        return make_array([holder, start, axis_to_reduce] (const index_t<1>& i)
+                        {
+                            NDARRAY_STATS_ACCESS(freeze_axis, 1);
+                            auto source_index = start;
+                            source_index[axis_to_reduce] = i[0];
+                            return (*holder)(source_index);
+                        }, make_shape(n));
+                    };
+                    using result_type = std::decay_t<decltype(the_operator(make_line(operand.get())))>;
+
+                    if constexpr (detail::is_array<result_type>::value)
+                    {
+                        return the_operator(make_line(operand));
+                    }
+                    else
+                    {
+                        return the_operator(make_line(operand.get()));
+                    }
+                }
+            };
+            return make_array(std::move(mapping), shape);
+        }
+    }
+
+    auto along_axis(std::size_t new_axis_to_reduce) const
+    {
+        return axis_reducer_t(new_axis_to_reduce, the_operator);
+    }
 
 private:
     //=========================================================================
-    shape_t<Rank> the_shape;
-    ValueType the_value;
+    std::size_t axis_to_reduce;
+    OperatorType the_operator;
 };
 
 
 
 
 //=============================================================================
-template<typename ValueType>
-class nd::buffer_t
+template<typename ArrayType>
+class nd::concatenator_t
 {
 public:
 
-    using value_type = ValueType;
-
     //=========================================================================
-    ~buffer_t() { delete [] memory; }
-    buffer_t() {}
-    buffer_t(const buffer_t& other) = delete;
-    buffer_t& operator=(const buffer_t& other) = delete;
+    concatenator_t(std::size_t axis_to_extend, ArrayType array_to_concat)
+    : axis_to_extend(axis_to_extend)
+    , array_to_concat(std::move(array_to_concat)) {}
 
-    buffer_t(buffer_t&& other)
+    template<typename SourceArrayType>
+    auto operator()(SourceArrayType&& array) const &
     {
-        memory = other.memory;
-        count = other.count;
-        other.memory = nullptr;
-        other.count = 0;
+        return concatenate(axis_to_extend, array_to_concat, std::forward<SourceArrayType>(array));
     }
 
-    buffer_t(std::size_t count, ValueType value=ValueType())
-    : count(count)
-    , memory(new ValueType[count])
+    template<typename SourceArrayType>
+    auto operator()(SourceArrayType&& array) &&
     {
-        for (std::size_t n = 0; n < count; ++n)
-        {
-            memory[n] = value;
-        }
+        return concatenate(axis_to_extend, std::move(array_to_concat), std::forward<SourceArrayType>(array));
     }
 
-    template<class IteratorType>
-    buffer_t(IteratorType first, IteratorType last)
-    : count(std::distance(first, last)), memory(new ValueType[count])
+    auto on_axis(std::size_t new_axis_to_concat) const &
     {
-        for (std::size_t n = 0; n < count; ++n)
-        {
-            memory[n] = *first++;
-        }
+        return concatenator_t(new_axis_to_concat, array_to_concat);
     }
 
-    buffer_t& operator=(buffer_t&& other)
+    auto on_axis(std::size_t new_axis_to_concat) &&
     {
-        delete [] memory;
-        memory = other.memory;
-        count = other.count;
-
-        other.memory = nullptr;
-        other.count = 0;
-        return *this;
+        return concatenator_t(new_axis_to_concat, std::move(array_to_concat));
     }
 
-    bool operator==(const buffer_t& other) const
+private:
+    //=========================================================================
+    template<typename ConcatArrayType, typename SourceArrayType>
+    static auto concatenate(std::size_t axis_to_extend, ConcatArrayType&& array_to_concat, SourceArrayType&& array)
     {
-        return count == other.count
-        && all_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) == std::get<1>(t); });
-    }
+        if (axis_to_extend >= rank(array))
+        {
+            throw std::logic_error("cannot concatenate on axis greater than or equal to array rank");
+        }
+        if (array_to_concat.shape().remove_elements(make_index(axis_to_extend))
+            !=        array.shape().remove_elements(make_index(axis_to_extend)))
+        {
+            throw std::logic_error("the shape of the concatenated arrays can only differ on the concatenating axis");
+        }
 
-    bool operator!=(const buffer_t& other) const
-    {
-        return count != other.count
-        || any_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) != std::get<1>(t); });
-    }
+        auto shape = array.shape();
+        shape[axis_to_extend] += array_to_concat.shape(axis_to_extend);
 
-    bool empty() const { return count == 0; }
-    std::size_t size() const { return count; }
+        using mapping_type = detail::concat_mapping_t<std::decay_t<SourceArrayType>, std::decay_t<ConcatArrayType>>;
 
-    const ValueType* data() const { return memory; }
-    const ValueType* begin() const { return memory; }
-    const ValueType* end() const { return memory + count; }
-    const ValueType& operator[](std::size_t offset) const { return memory[offset]; }
-    const ValueType& at(std::size_t offset) const
-    {
-        if (offset >= count)
-        {
-            throw std::out_of_range("buffer_t index out of range");
-        }
-        return memory[offset];
+        return make_array(mapping_type(axis_to_extend, std::forward<SourceArrayType>(array), std::forward<ConcatArrayType>(array_to_concat)), shape);
     }
 
-    ValueType* data() { return memory; }
+    std::size_t axis_to_extend;
+    ArrayType array_to_concat;
+};
+
+
+
+
+//=============================================================================
+template<typename Function, std::size_t Rank>
+class nd::basic_provider_t
+{
+public:
+
+    using value_type = std::invoke_result_t<Function, index_t<Rank>>;
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    basic_provider_t(Function mapping, shape_t<Rank> the_shape) : mapping(std::move(mapping)), the_shape(the_shape) {}
+    decltype(auto) operator()(const index_t<Rank>& index) const { return mapping(index); }
+    auto shape() const { return the_shape; }
+    auto size() const { return the_shape.volume(); }
+
+    /**
+     * Evaluate count consecutive elements along the last axis, starting at
+     * the given index. Only available if the mapping provides it.
+     */
+    template<typename ValueType, typename M=Function>
+    auto evaluate_row(const index_t<Rank>& index, ValueType* target, std::size_t count) const
+    -> decltype(std::declval<const M&>().evaluate_row(index, target, count))
+    {
+        return mapping.evaluate_row(index, target, count);
+    }
+
+    const Function& get_mapping() const { return mapping; }
+
+    template<std::size_t R> auto reshape(shape_t<R>) const
+    {
+        throw std::logic_error("array provider cannot be reshaped");
+    }
+
+private:
+    //=========================================================================
+    Function mapping;
+    shape_t<Rank> the_shape;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, typename ValueType>
+class nd::shared_provider_t
+{
+public:
+
+    using value_type = ValueType;
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    shared_provider_t(nd::shape_t<Rank> the_shape, std::shared_ptr<nd::buffer_t<ValueType>> buffer)
+    : the_shape(the_shape)
+    , the_strides(make_strides_row_major(the_shape))
+    , buffer(buffer)
+    {
+        if (the_shape.volume() != buffer->size())
+        {
+            throw std::logic_error("shape and buffer sizes do not match");
+        }
+    }
+
+    /**
+     * Construct a strided view of part of the buffer: the element at index i
+     * is found at the memory offset start + strides.compute_offset(i).
+     */
+    shared_provider_t(
+        nd::shape_t<Rank> the_shape,
+        std::shared_ptr<nd::buffer_t<ValueType>> buffer,
+        memory_strides_t<Rank> the_strides,
+        std::size_t start)
+    : shared_provider_t(the_shape, buffer, the_strides, start, unchecked_t())
+    {
+        auto extent = start;
+
+        for (std::size_t n = 0; n < Rank; ++n)
+        {
+            extent += (the_shape[n] - 1) * the_strides[n];
+        }
+        if (the_shape.volume() > 0 && extent >= buffer->size())
+        {
+            throw std::logic_error("strided view extends past the end of the buffer");
+        }
+    }
+
+    const ValueType& operator()(const index_t<Rank>& index) const
+    {
+        return buffer->operator[](start + the_strides.compute_offset(index));
+    }
+
+    void evaluate_row(const index_t<Rank>& index, ValueType* target, std::size_t count) const
+    {
+        auto source = buffer->data() + (start + the_strides.compute_offset(index));
+        auto stride = the_strides[Rank - 1];
+
+        if (stride == 1)
+        {
+            std::copy_n(source, count, target);
+        }
+        else
+        {
+            for (std::size_t n = 0; n < count; ++n)
+            {
+                target[n] = source[n * stride];
+            }
+        }
+    }
+
+    auto shape() const { return the_shape; }
+    auto size() const { return the_shape.volume(); }
+    auto strides() const { return the_strides; }
+    bool contiguous() const { return starts_in_buffer() && the_strides == make_strides_row_major(the_shape); }
+    const ValueType* data() const { return starts_in_buffer() ? buffer->data() + start : nullptr; }
+
+    template<std::size_t R> auto reshape(shape_t<R> new_shape) const
+    {
+        if (! contiguous())
+        {
+            throw std::logic_error("a strided view with non-row-major strides cannot be reshaped");
+        }
+        if (new_shape.volume() != size())
+        {
+            throw std::logic_error("shape and buffer sizes do not match");
+        }
+        return shared_provider_t<R, ValueType>(new_shape, buffer, make_strides_row_major(new_shape), start);
+    }
+
+    /**
+     * Return a provider sharing this one's buffer, whose element at index i is
+     * this one's data()[offset + strides.compute_offset(i)].
+     */
+    template<std::size_t R> auto with_layout(shape_t<R> new_shape, memory_strides_t<R> new_strides, std::size_t offset) const
+    {
+        using result_type = shared_provider_t<R, ValueType>;
+        return result_type(new_shape, buffer, new_strides, start + offset, typename result_type::unchecked_t());
+    }
+
+private:
+    //=========================================================================
+    template<std::size_t, typename> friend class nd::shared_provider_t;
+    struct unchecked_t {};
+
+    /**
+     * Views made by with_layout are not bounds-checked: the offset may wrap
+     * around, as for a positive shift, where the leading elements are not
+     * readable (as with the lazily remapped shift). Offsets are summed before
+     * a pointer is formed, and such a view has no data pointer.
+     */
+    shared_provider_t(
+        nd::shape_t<Rank> the_shape,
+        std::shared_ptr<nd::buffer_t<ValueType>> buffer,
+        memory_strides_t<Rank> the_strides,
+        std::size_t start,
+        unchecked_t)
+    : the_shape(the_shape)
+    , the_strides(the_strides)
+    , buffer(buffer)
+    , start(start) {}
+
+    bool starts_in_buffer() const { return std::ptrdiff_t(start) >= 0; }
+
+    //=========================================================================
+    shape_t<Rank> the_shape;
+    memory_strides_t<Rank> the_strides;
+    std::shared_ptr<buffer_t<ValueType>> buffer;
+    std::size_t start = 0;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, typename ValueType>
+class nd::unique_provider_t
+{
+public:
+
+    using value_type = ValueType;
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    unique_provider_t(nd::shape_t<Rank> the_shape, nd::buffer_t<ValueType>&& buffer)
+    : the_shape(the_shape)
+    , strides(make_strides_row_major(the_shape))
+    , buffer(std::move(buffer))
+    {
+        if (the_shape.volume() != unique_provider_t::buffer.size())
+        {
+            throw std::logic_error("shape and buffer sizes do not match");
+        }
+    }
+
+    const ValueType& operator()(const index_t<Rank>& index) const { return buffer.operator[](strides.compute_offset(index)); }
+    /* */ ValueType& operator()(const index_t<Rank>& index)       { return buffer.operator[](strides.compute_offset(index)); }
+    template<typename... Args> const ValueType& operator()(Args... args) const { return operator()(make_index(args...)); }
+    template<typename... Args> /* */ ValueType& operator()(Args... args)       { return operator()(make_index(args...)); }
+
+    void evaluate_row(const index_t<Rank>& index, ValueType* target, std::size_t count) const
+    {
+        std::copy_n(buffer.data() + strides.compute_offset(index), count, target);
+    }
+
+    auto shape() const { return the_shape; }
+    auto size() const { return the_shape.volume(); }
+    const ValueType* data() const { return buffer.data(); }
+    ValueType* data() { return buffer.data(); }
+
+    auto shared() const & { return shared_provider_t(the_shape, std::make_shared<buffer_t<ValueType>>(buffer.begin(), buffer.end())); }
+    auto shared()      && { return shared_provider_t(the_shape, std::make_shared<buffer_t<ValueType>>(std::move(buffer))); }
+
+    template<std::size_t R> auto reshape(shape_t<R> new_shape) const & { return unique_provider_t<R, ValueType>(new_shape, buffer_t<ValueType>(buffer.begin(), buffer.end())); }
+    template<std::size_t R> auto reshape(shape_t<R> new_shape)      && { return unique_provider_t<R, ValueType>(new_shape, std::move(buffer)); }
+
+private:
+    //=========================================================================
+    shape_t<Rank> the_shape;
+    memory_strides_t<Rank> strides;
+    buffer_t<ValueType> buffer;
+};
+
+
+
+
+//=============================================================================
+template<typename ValueType, std::size_t... Dims>
+class nd::static_provider_t
+{
+public:
+
+    using value_type = ValueType;
+    static constexpr std::size_t rank = sizeof...(Dims);
+    static constexpr std::size_t volume = (Dims * ... * 1);
+    static_assert(rank > 0, "a static array must have at least one axis");
+
+    //=========================================================================
+    constexpr static_provider_t() : memory() {}
+    constexpr static_provider_t(const std::array<ValueType, volume>& memory) : memory(memory) {}
+
+    constexpr const ValueType& operator()(const index_t<rank>& index) const { return memory[compute_offset(index)]; }
+    constexpr /* */ ValueType& operator()(const index_t<rank>& index)       { return memory[compute_offset(index)]; }
+    template<typename... Args> constexpr const ValueType& operator()(Args... args) const { return operator()(make_index(args...)); }
+    template<typename... Args> constexpr /* */ ValueType& operator()(Args... args)       { return operator()(make_index(args...)); }
+
+    void evaluate_row(const index_t<rank>& index, ValueType* target, std::size_t count) const
+    {
+        std::copy_n(memory.data() + compute_offset(index), count, target);
+    }
+
+    constexpr auto shape() const { return shape_t<rank>({Dims...}); }
+    constexpr auto size() const { return volume; }
+    constexpr const ValueType* data() const { return memory.data(); }
+    constexpr ValueType* data() { return memory.data(); }
+
+    template<std::size_t R> auto reshape(shape_t<R> new_shape) const { return unique_provider_t<R, ValueType>(new_shape, buffer_t<ValueType>(memory.begin(), memory.end())); }
+
+private:
+    //=========================================================================
+    static constexpr std::size_t compute_offset(const index_t<rank>& index)
+    {
+        constexpr std::size_t dims[] = {Dims...};
+        std::size_t offset = 0;
+
+        for (std::size_t n = 0; n < rank; ++n)
+        {
+            offset = offset * dims[n] + index[n];
+        }
+        return offset;
+    }
+    std::array<ValueType, volume> memory;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, typename ValueType>
+class nd::uniform_provider_t
+{
+public:
+
+    using value_type = ValueType;
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    uniform_provider_t(shape_t<Rank> the_shape, ValueType the_value) : the_shape(the_shape), the_value(the_value) {}
+    const ValueType& operator()(const index_t<Rank>&) const { return the_value; }
+    void evaluate_row(const index_t<Rank>&, ValueType* target, std::size_t count) const { std::fill_n(target, count, the_value); }
+    auto shape() const { return the_shape; }
+    auto size() const { return the_shape.volume(); }
+    template<std::size_t NewRank> auto reshape(shape_t<NewRank> new_shape) const { return uniform_provider_t<NewRank, ValueType>(new_shape, the_value); }
+
+private:
+    //=========================================================================
+    shape_t<Rank> the_shape;
+    ValueType the_value;
+};
+
+
+
+
+//=============================================================================
+class nd::detail::mapped_file_t
+{
+public:
+
+    //=========================================================================
+    mapped_file_t(const std::string& filename)
+    {
+#ifdef NDARRAY_HAVE_MMAP
+        auto descriptor = ::open(filename.data(), O_RDONLY);
+
+        if (descriptor == -1)
+        {
+            throw std::runtime_error("could not open " + filename);
+        }
+        struct stat status;
+
+        if (::fstat(descriptor, &status) == -1)
+        {
+            ::close(descriptor);
+            throw std::runtime_error("could not stat " + filename);
+        }
+        if ((length = status.st_size) > 0)
+        {
+            memory = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, descriptor, 0);
+        }
+        ::close(descriptor);
+
+        if (memory == MAP_FAILED)
+        {
+            memory = nullptr;
+            throw std::runtime_error("could not memory-map " + filename);
+        }
+#else
+        throw std::runtime_error("memory-mapped files are not supported on this platform: " + filename);
+#endif
+    }
+
+    ~mapped_file_t()
+    {
+#ifdef NDARRAY_HAVE_MMAP
+        if (memory)
+        {
+            ::munmap(memory, length);
+        }
+#endif
+    }
+
+    mapped_file_t(const mapped_file_t& other) = delete;
+    mapped_file_t& operator=(const mapped_file_t& other) = delete;
+
+    const char* data() const { return static_cast<const char*>(memory); }
+    std::size_t size() const { return length; }
+
+private:
+    //=========================================================================
+    void* memory = nullptr;
+    std::size_t length = 0;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, typename ValueType>
+class nd::mmap_provider_t
+{
+public:
+
+    using value_type = ValueType;
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    mmap_provider_t(shape_t<Rank> the_shape, std::shared_ptr<const detail::mapped_file_t> file, std::size_t byte_offset)
+    : the_shape(the_shape)
+    , strides(make_strides_row_major(the_shape))
+    , file(file)
+    , byte_offset(byte_offset)
+    {
+        if (byte_offset + the_shape.volume() * sizeof(ValueType) > file->size())
+        {
+            throw std::logic_error("shape is larger than the mapped file");
+        }
+        if (reinterpret_cast<std::uintptr_t>(data()) % alignof(ValueType) != 0)
+        {
+            throw std::logic_error("mapped data is misaligned for the value type");
+        }
+    }
+
+    const ValueType& operator()(const index_t<Rank>& index) const
+    {
+        return data()[strides.compute_offset(index)];
+    }
+
+    void evaluate_row(const index_t<Rank>& index, ValueType* target, std::size_t count) const
+    {
+        std::copy_n(data() + strides.compute_offset(index), count, target);
+    }
+
+    auto shape() const { return the_shape; }
+    auto size() const { return the_shape.volume(); }
+    const ValueType* data() const { return reinterpret_cast<const ValueType*>(file->data() + byte_offset); }
+    template<std::size_t R> auto reshape(shape_t<R> new_shape) const { return mmap_provider_t<R, ValueType>(new_shape, file, byte_offset); }
+
+    /**
+     * A strided view of the mapped data, with the same meaning as
+     * shared_provider_t::with_layout; the view keeps the file mapped.
+     */
+    template<std::size_t R> auto with_layout(shape_t<R> new_shape, memory_strides_t<R> new_strides, std::size_t offset) const
+    {
+        return view_provider_t<Rank, const ValueType>(data(), the_shape, strides, file).with_layout(new_shape, new_strides, offset);
+    }
+
+private:
+    //=========================================================================
+    shape_t<Rank> the_shape;
+    memory_strides_t<Rank> strides;
+    std::shared_ptr<const detail::mapped_file_t> file;
+    std::size_t byte_offset;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, typename ValueType>
+class nd::view_provider_t
+{
+public:
+
+    using value_type = std::remove_const_t<ValueType>;
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    /**
+     * Make a view of memory owned elsewhere. If an owner is given, the view
+     * keeps it alive (for example, the mapped file of a map_npy array).
+     */
+    view_provider_t(ValueType* memory, shape_t<Rank> the_shape, memory_strides_t<Rank> the_strides, std::shared_ptr<const void> owner={})
+    : memory(memory)
+    , the_shape(the_shape)
+    , the_strides(the_strides)
+    , owner(std::move(owner)) {}
+
+    ValueType& operator()(const index_t<Rank>& index) const
+    {
+        return memory[start + the_strides.compute_offset(index)];
+    }
+
+    void evaluate_row(const index_t<Rank>& index, value_type* target, std::size_t count) const
+    {
+        auto source = memory + (start + the_strides.compute_offset(index));
+        auto stride = the_strides[Rank - 1];
+
+        for (std::size_t n = 0; n < count; ++n)
+        {
+            target[n] = source[n * stride];
+        }
+    }
+
+    auto shape() const { return the_shape; }
+    auto size() const { return the_shape.volume(); }
+    auto strides() const { return the_strides; }
+    bool contiguous() const { return starts_in_memory() && the_strides == make_strides_row_major(the_shape); }
+    ValueType* data() const { return starts_in_memory() ? memory + start : nullptr; }
+
+    template<std::size_t R> auto reshape(shape_t<R> new_shape) const
+    {
+        if (! contiguous())
+        {
+            throw std::logic_error("a view with non-row-major strides cannot be reshaped");
+        }
+        return view_provider_t<R, ValueType>(data(), new_shape, make_strides_row_major(new_shape), owner);
+    }
+
+    /**
+     * As for shared_provider_t::with_layout, the offset may wrap around; it
+     * is summed with the element offsets before a pointer is formed.
+     */
+    template<std::size_t R> auto with_layout(shape_t<R> new_shape, memory_strides_t<R> new_strides, std::size_t offset) const
+    {
+        auto result = view_provider_t<R, ValueType>(memory, new_shape, new_strides, owner);
+        result.start = start + offset;
+        return result;
+    }
+
+private:
+    //=========================================================================
+    template<std::size_t, typename> friend class nd::view_provider_t;
+
+    bool starts_in_memory() const { return std::ptrdiff_t(start) >= 0; }
+
+    //=========================================================================
+    ValueType* memory;
+    shape_t<Rank> the_shape;
+    memory_strides_t<Rank> the_strides;
+    std::shared_ptr<const void> owner;
+    std::size_t start = 0;
+};
+
+
+
+
+//=============================================================================
+template<typename Provider>
+class nd::cached_provider_t
+{
+public:
+
+    using value_type = typename Provider::value_type;
+    static constexpr std::size_t rank = Provider::rank;
+
+    //=========================================================================
+    cached_provider_t(Provider source, shape_t<rank> tile_shape)
+    : state(std::make_shared<state_t>(std::move(source), tile_shape)) {}
+
+    const value_type& operator()(const index_t<rank>& index) const
+    {
+        NDARRAY_STATS_ACCESS(cache, 1);
+        state->require_tile(index);
+        return state->memory[state->strides.compute_offset(index)];
+    }
+
+    void evaluate_row(const index_t<rank>& index, value_type* target, std::size_t count) const
+    {
+        auto i = index;
+        NDARRAY_STATS_ACCESS(cache, count);
+
+        for (std::size_t k = 0; k < count;)
+        {
+            auto tile_final = (i[rank - 1] / state->tile_shape[rank - 1] + 1) * state->tile_shape[rank - 1];
+            auto n = std::min(count - k, tile_final - i[rank - 1]);
+
+            state->require_tile(i);
+            std::copy_n(state->memory.data() + state->strides.compute_offset(i), n, target + k);
+            i[rank - 1] += n;
+            k += n;
+        }
+    }
+
+    auto shape() const { return state->source.shape(); }
+    auto size() const { return state->source.size(); }
+
+    template<std::size_t R> auto reshape(shape_t<R>) const
+    {
+        throw std::logic_error("array provider cannot be reshaped");
+    }
+
+private:
+    //=========================================================================
+    struct state_t
+    {
+        state_t(Provider source, shape_t<rank> tile_shape)
+        : source(source)
+        , tile_shape(tile_shape)
+        , strides(make_strides_row_major(source.shape()))
+        {
+            if (any_of(tile_shape, [] (auto s) { return s == 0; }))
+            {
+                throw std::logic_error("tiles must have a non-zero extent on each axis");
+            }
+            for (std::size_t n = 0; n < rank; ++n)
+            {
+                tile_counts[n] = (source.shape()[n] + tile_shape[n] - 1) / tile_shape[n];
+            }
+            flags = std::make_unique<std::once_flag[]>(tile_counts.volume());
+        }
+
+        /**
+         * Evaluate the tile containing the given index, if it has not been
+         * evaluated already. Concurrent callers wait for the first to finish.
+         * The memory for the whole array is allocated on the first call.
+         */
+        void require_tile(const index_t<rank>& index)
+        {
+            std::call_once(allocated, [this] { memory = buffer_t<value_type>(source.size(), uninitialized); });
+
+            auto tile = index_t<rank>();
+
+            for (std::size_t n = 0; n < rank; ++n)
+            {
+                tile[n] = index[n] / tile_shape[n];
+            }
+            std::call_once(flags[make_strides_row_major(tile_counts).compute_offset(tile)], [this, &tile]
+            {
+                auto region = access_pattern_t<rank>();
+
+                for (std::size_t n = 0; n < rank; ++n)
+                {
+                    region.start[n] = tile[n] * tile_shape[n];
+                    region.final[n] = std::min(source.shape()[n], region.start[n] + tile_shape[n]);
+                }
+                detail::for_each_row(region, [this] (const auto& i, std::size_t count)
+                {
+                    detail::evaluate_row(source, i, memory.data() + strides.compute_offset(i), count);
+                });
+            });
+        }
+
+        Provider source;
+        shape_t<rank> tile_shape;
+        shape_t<rank> tile_counts;
+        memory_strides_t<rank> strides;
+        buffer_t<value_type> memory;
+        std::once_flag allocated;
+        std::unique_ptr<std::once_flag[]> flags;
+    };
+    std::shared_ptr<state_t> state;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, typename ValueType>
+class nd::block_sparse_provider_t
+{
+public:
+
+    using value_type = ValueType;
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    /**
+     * Make a provider from its tiles, given in row-major order of the tile
+     * grid. Each tile is either an empty buffer, meaning it holds only the
+     * background value, or the tile_shape.volume() values of a whole tile in
+     * row-major order; tiles on the upper edges of the shape are padded out
+     * to the full tile shape.
+     */
+    block_sparse_provider_t(shape_t<Rank> the_shape, shape_t<Rank> tile_shape, ValueType background, std::vector<buffer_t<ValueType>> tiles)
+    : state(std::make_shared<state_t>(the_shape, tile_shape, std::move(background), std::move(tiles))) {}
+
+    const ValueType& operator()(const index_t<Rank>& index) const
+    {
+        auto tile = index_t<Rank>();
+        auto local = index_t<Rank>();
+
+        for (std::size_t n = 0; n < Rank; ++n)
+        {
+            tile[n] = index[n] / state->tile_shape[n];
+            local[n] = index[n] - tile[n] * state->tile_shape[n];
+        }
+        const auto& buffer = state->tiles[state->grid_strides.compute_offset(tile)];
+        return buffer.empty() ? state->background : buffer[state->tile_strides.compute_offset(local)];
+    }
+
+    void evaluate_row(const index_t<Rank>& index, ValueType* target, std::size_t count) const
+    {
+        auto tile = index_t<Rank>();
+        auto local = index_t<Rank>();
+
+        for (std::size_t n = 0; n < Rank; ++n)
+        {
+            tile[n] = index[n] / state->tile_shape[n];
+            local[n] = index[n] - tile[n] * state->tile_shape[n];
+        }
+        for (std::size_t k = 0; k < count;)
+        {
+            auto n = std::min(count - k, state->tile_shape[Rank - 1] - local[Rank - 1]);
+            const auto& buffer = state->tiles[state->grid_strides.compute_offset(tile)];
+
+            if (buffer.empty())
+            {
+                std::fill_n(target + k, n, state->background);
+            }
+            else
+            {
+                std::copy_n(buffer.data() + state->tile_strides.compute_offset(local), n, target + k);
+            }
+            local[Rank - 1] = 0;
+            ++tile[Rank - 1];
+            k += n;
+        }
+    }
+
+    /**
+     * Call fn(part, dense) for each tile intersecting the given region, whose
+     * jumps must all be 1. The part is the intersection of the tile with the
+     * region, and dense is false if the tile holds only the background value.
+     */
+    template<typename Function>
+    void for_each_tile(const access_pattern_t<Rank>& region, Function&& fn) const
+    {
+        if (region.empty())
+        {
+            return;
+        }
+        auto tiles = access_pattern_t<Rank>();
+
+        for (std::size_t n = 0; n < Rank; ++n)
+        {
+            tiles.start[n] = region.start[n] / state->tile_shape[n];
+            tiles.final[n] = (region.final[n] - 1) / state->tile_shape[n] + 1;
+        }
+        for (const auto& tile : tiles)
+        {
+            auto part = region;
+
+            for (std::size_t n = 0; n < Rank; ++n)
+            {
+                part.start[n] = std::max(region.start[n], tile[n] * state->tile_shape[n]);
+                part.final[n] = std::min(region.final[n], (tile[n] + 1) * state->tile_shape[n]);
+            }
+            fn(static_cast<const access_pattern_t<Rank>&>(part), ! state->tiles[state->grid_strides.compute_offset(tile)].empty());
+        }
+    }
+
+    auto shape() const { return state->the_shape; }
+    auto size() const { return state->the_shape.volume(); }
+    auto tile_shape() const { return state->tile_shape; }
+    const ValueType& background() const { return state->background; }
+    std::size_t num_tiles() const { return state->tiles.size(); }
+
+    std::size_t num_dense_tiles() const
+    {
+        return std::count_if(state->tiles.begin(), state->tiles.end(), [] (const auto& buffer) { return ! buffer.empty(); });
+    }
+
+    template<std::size_t R> auto reshape(shape_t<R>) const
+    {
+        throw std::logic_error("array provider cannot be reshaped");
+    }
+
+private:
+    //=========================================================================
+    struct state_t
+    {
+        state_t(shape_t<Rank> the_shape, shape_t<Rank> tile_shape, ValueType background, std::vector<buffer_t<ValueType>> tiles)
+        : the_shape(the_shape)
+        , tile_shape(tile_shape)
+        , tile_strides(make_strides_row_major(tile_shape))
+        , background(std::move(background))
+        , tiles(std::move(tiles))
+        {
+            if (any_of(tile_shape, [] (auto s) { return s == 0; }))
+            {
+                throw std::logic_error("tiles must have a non-zero extent on each axis");
+            }
+            auto tile_counts = shape_t<Rank>();
+
+            for (std::size_t n = 0; n < Rank; ++n)
+            {
+                tile_counts[n] = (the_shape[n] + tile_shape[n] - 1) / tile_shape[n];
+            }
+            grid_strides = make_strides_row_major(tile_counts);
+
+            if (this->tiles.size() != tile_counts.volume())
+            {
+                throw std::logic_error("a block-sparse array needs one (possibly empty) buffer per tile");
+            }
+            for (const auto& buffer : this->tiles)
+            {
+                if (! buffer.empty() && buffer.size() != tile_shape.volume())
+                {
+                    throw std::logic_error("each dense tile of a block-sparse array must hold a whole tile");
+                }
+            }
+        }
+
+        shape_t<Rank> the_shape;
+        shape_t<Rank> tile_shape;
+        memory_strides_t<Rank> tile_strides;
+        memory_strides_t<Rank> grid_strides;
+        ValueType background;
+        std::vector<buffer_t<ValueType>> tiles;
+    };
+    std::shared_ptr<const state_t> state;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, typename... ValueTypes>
+class nd::soa_provider_t
+{
+public:
+
+    using value_type = std::tuple<ValueTypes...>;
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    /**
+     * Make a provider of tuples from one shared provider per component. The
+     * components must all have the same shape, and row-major strides.
+     */
+    soa_provider_t(std::tuple<shared_provider_t<Rank, ValueTypes>...> components)
+    : components(std::move(components))
+    , the_shape(std::get<0>(this->components).shape())
+    , the_strides(make_strides_row_major(the_shape))
+    {
+        std::apply([this] (const auto&... c)
+        {
+            if (((c.shape() != the_shape || ! c.contiguous()) || ...))
+            {
+                throw std::logic_error("the components of a struct-of-arrays provider must have one shape and row-major strides");
+            }
+        }, this->components);
+    }
+
+    value_type operator()(const index_t<Rank>& index) const
+    {
+        return std::apply([&index] (const auto&... c) { return value_type(c(index)...); }, components);
+    }
+
+    void evaluate_row(const index_t<Rank>& index, value_type* target, std::size_t count) const
+    {
+        auto offset = the_strides.compute_offset(index);
+
+        std::apply([offset, target, count] (const auto&... c)
+        {
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                target[k] = value_type(c.data()[offset + k]...);
+            }
+        }, components);
+    }
+
+    auto shape() const { return the_shape; }
+    auto size() const { return the_shape.volume(); }
+
+    /**
+     * Return the shared provider holding component I of each element.
+     */
+    template<std::size_t I> auto component() const { return std::get<I>(components); }
+
+    template<std::size_t R> auto reshape(shape_t<R> new_shape) const
+    {
+        return soa_provider_t<R, ValueTypes...>(std::apply([new_shape] (const auto&... c)
+        {
+            return std::make_tuple(c.reshape(new_shape)...);
+        }, components));
+    }
+
+private:
+    //=========================================================================
+    std::tuple<shared_provider_t<Rank, ValueTypes>...> components;
+    shape_t<Rank> the_shape;
+    memory_strides_t<Rank> the_strides;
+};
+
+
+
+
+//=============================================================================
+struct nd::stats_t
+{
+    std::size_t allocations = 0;
+    std::size_t allocated_bytes = 0;
+    std::size_t evaluations = 0;
+    std::size_t evaluated_elements = 0;
+    double evaluation_seconds = 0.0;
+
+    // Number of elements read from the arrays returned by each lazy operator,
+    // keyed by operator name ("transform", "select", "collect", ...)
+    std::map<std::string, std::size_t> element_accesses;
+};
+
+
+
+
+//=============================================================================
+struct nd::detail::stats_counters_t
+{
+    std::atomic<std::size_t> allocations {0};
+    std::atomic<std::size_t> allocated_bytes {0};
+    std::atomic<std::size_t> evaluations {0};
+    std::atomic<std::size_t> evaluated_elements {0};
+    std::atomic<std::size_t> evaluation_nanoseconds {0};
+    std::atomic<std::size_t> accesses[std::size_t(counted_operator::count)] = {};
+
+    static const char* name(counted_operator op)
+    {
+        static const char* names[] = {
+            "transform", "binary_op", "select", "select_axis", "shift", "freeze_axis", "collect", "concat",
+            "replace", "read_indexes", "zip_arrays", "cartesian_product", "stencil", "cache", "permute_axes"};
+        return names[std::size_t(op)];
+    }
+};
+
+
+
+
+//=============================================================================
+class nd::detail::scoped_timer_t
+{
+public:
+
+    //=========================================================================
+    scoped_timer_t(std::atomic<std::size_t>& nanoseconds)
+    : nanoseconds(nanoseconds)
+    , start(std::chrono::steady_clock::now()) {}
+
+    ~scoped_timer_t()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        nanoseconds.fetch_add(std::size_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), std::memory_order_relaxed);
+    }
+
+private:
+    //=========================================================================
+    std::atomic<std::size_t>& nanoseconds;
+    std::chrono::steady_clock::time_point start;
+};
+
+
+
+
+//=============================================================================
+nd::detail::stats_counters_t& nd::detail::stats_counters()
+{
+    static stats_counters_t counters;
+    return counters;
+}
+
+void nd::detail::count_accesses(counted_operator op, std::size_t count)
+{
+    stats_counters().accesses[std::size_t(op)].fetch_add(count, std::memory_order_relaxed);
+}
+
+
+
+
+/**
+ * @brief      Return a snapshot of the instrumentation counters. They are all
+ *             zero unless NDARRAY_ENABLE_STATS was defined before including
+ *             this header (in every translation unit).
+ *
+ * @return     The counters
+ */
+nd::stats_t nd::stats()
+{
+    auto& counters = detail::stats_counters();
+    auto result = stats_t();
+
+    result.allocations = counters.allocations;
+    result.allocated_bytes = counters.allocated_bytes;
+    result.evaluations = counters.evaluations;
+    result.evaluated_elements = counters.evaluated_elements;
+    result.evaluation_seconds = 1e-9 * double(counters.evaluation_nanoseconds);
+
+    for (std::size_t n = 0; n < std::size_t(detail::counted_operator::count); ++n)
+    {
+        result.element_accesses[detail::stats_counters_t::name(detail::counted_operator(n))] = counters.accesses[n];
+    }
+    return result;
+}
+
+
+
+
+/**
+ * @brief      Set all the instrumentation counters to zero.
+ */
+void nd::reset_stats()
+{
+    auto& counters = detail::stats_counters();
+
+    counters.allocations = 0;
+    counters.allocated_bytes = 0;
+    counters.evaluations = 0;
+    counters.evaluated_elements = 0;
+    counters.evaluation_nanoseconds = 0;
+
+    for (auto& count : counters.accesses)
+    {
+        count = 0;
+    }
+}
+
+
+
+
+//=============================================================================
+class nd::memory_pool_t
+{
+public:
+
+    static constexpr std::size_t alignment = 64;
+
+    //=========================================================================
+    /**
+     * Return the process-wide pool used by allocator_t. It is never destroyed,
+     * so buffers with static storage duration may safely outlive it.
+     */
+    static memory_pool_t& instance()
+    {
+        static auto pool = new memory_pool_t;
+        return *pool;
+    }
+
+    /**
+     * Return a block of at least the given size, aligned to the given
+     * alignment. Block sizes are rounded up to a size class (at most 25%
+     * larger), so that released blocks can be recycled for similar requests.
+     */
+    void* allocate(std::size_t bytes, std::size_t align)
+    {
+        if (align > alignment)
+        {
+            return ::operator new(bytes, std::align_val_t(align));
+        }
+        auto size = size_class(bytes);
+
+        if (enabled())
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex);
+            auto& blocks = free_blocks[size];
+
+            if (! blocks.empty())
+            {
+                auto block = blocks.back();
+                blocks.pop_back();
+                cached -= size;
+                return block;
+            }
+        }
+        return ::operator new(size, std::align_val_t(alignment));
+    }
+
+    void deallocate(void* block, std::size_t bytes, std::size_t align)
+    {
+        if (align > alignment)
+        {
+            ::operator delete(block, std::align_val_t(align));
+            return;
+        }
+        if (enabled())
+        {
+            // The pool may have been disabled and emptied since the check
+            // above; blocks are only cached if it is still enabled.
+            auto lock = std::lock_guard<std::mutex>(mutex);
+
+            if (is_enabled)
+            {
+                free_blocks[size_class(bytes)].push_back(block);
+                cached += size_class(bytes);
+                return;
+            }
+        }
+        ::operator delete(block, std::align_val_t(alignment));
+    }
+
+    /**
+     * Enable or disable recycling of released blocks. The pool is disabled by
+     * default; disabling it returns any cached blocks to the system.
+     */
+    void set_enabled(bool should_enable)
+    {
+        is_enabled = should_enable;
+
+        if (! should_enable)
+        {
+            release();
+        }
+    }
+
+    bool enabled() const { return is_enabled; }
+
+    /**
+     * Return all the cached blocks to the system.
+     */
+    void release()
+    {
+        auto lock = std::lock_guard<std::mutex>(mutex);
+
+        for (auto& [size, blocks] : free_blocks)
+        {
+            for (auto block : blocks)
+            {
+                ::operator delete(block, std::align_val_t(alignment));
+            }
+        }
+        free_blocks.clear();
+        cached = 0;
+    }
+
+    /**
+     * Return the number of bytes held in released blocks, pending reuse.
+     */
+    std::size_t cached_bytes() const
+    {
+        auto lock = std::lock_guard<std::mutex>(mutex);
+        return cached;
+    }
+
+    static std::size_t size_class(std::size_t bytes)
+    {
+        auto upper = alignment;
+
+        while (upper < bytes)
+        {
+            upper *= 2;
+        }
+        if (upper == alignment)
+        {
+            return upper;
+        }
+        auto size = upper / 2;
+
+        while (size < bytes)
+        {
+            size += upper / 8;
+        }
+        return size;
+    }
+
+private:
+    //=========================================================================
+    memory_pool_t() {}
+    std::unordered_map<std::size_t, std::vector<void*>> free_blocks;
+    std::size_t cached = 0;
+    std::atomic<bool> is_enabled = false;
+    mutable std::mutex mutex;
+};
+
+
+
+
+//=============================================================================
+template<typename ValueType, std::size_t Alignment>
+class nd::allocator_t
+{
+public:
+
+    using value_type = ValueType;
+    static constexpr std::size_t alignment = std::max(Alignment, alignof(ValueType));
+
+    template<typename OtherValueType>
+    struct rebind
+    {
+        using other = allocator_t<OtherValueType, Alignment>;
+    };
+
+    //=========================================================================
+    allocator_t() {}
+    template<typename OtherValueType> allocator_t(const allocator_t<OtherValueType, Alignment>&) {}
+
+    ValueType* allocate(std::size_t count)
+    {
+        NDARRAY_STATS_ADD(allocations, 1);
+        NDARRAY_STATS_ADD(allocated_bytes, count * sizeof(ValueType));
+        return static_cast<ValueType*>(memory_pool_t::instance().allocate(count * sizeof(ValueType), alignment));
+    }
+
+    void deallocate(ValueType* memory, std::size_t count)
+    {
+        memory_pool_t::instance().deallocate(memory, count * sizeof(ValueType), alignment);
+    }
+
+    bool operator==(const allocator_t&) const { return true; }
+    bool operator!=(const allocator_t&) const { return false; }
+};
+
+
+
+
+//=============================================================================
+template<typename ValueType, typename Allocator>
+class nd::buffer_t
+{
+public:
+
+    using value_type = ValueType;
+    using allocator_type = Allocator;
+
+    //=========================================================================
+    ~buffer_t() { release(); }
+    buffer_t() {}
+    buffer_t(const buffer_t& other) = delete;
+    buffer_t& operator=(const buffer_t& other) = delete;
+
+    buffer_t(buffer_t&& other) : allocator(std::move(other.allocator))
+    {
+        memory = other.memory;
+        count = other.count;
+        other.memory = nullptr;
+        other.count = 0;
+    }
+
+    buffer_t(std::size_t count, ValueType value=ValueType())
+    : count(count)
+    , memory(allocate(count))
+    {
+        construct([&] { std::uninitialized_fill_n(memory, count, value); });
+    }
+
+    /**
+     * Allocate a buffer whose elements are left uninitialized, if ValueType
+     * is trivially default-constructible, and default-constructed otherwise.
+     * Use this when every element is about to be overwritten.
+     */
+    buffer_t(std::size_t count, uninitialized_t)
+    : count(count)
+    , memory(allocate(count))
+    {
+        if constexpr (! std::is_trivially_default_constructible<ValueType>::value)
+        {
+            construct([&] { std::uninitialized_default_construct_n(memory, count); });
+        }
+    }
+
+    template<class IteratorType>
+    buffer_t(IteratorType first, IteratorType last)
+    : count(std::distance(first, last)), memory(allocate(count))
+    {
+        construct([&] { std::uninitialized_copy(first, last, memory); });
+    }
+
+    buffer_t& operator=(buffer_t&& other)
+    {
+        if (this != &other)
+        {
+            release();
+            allocator = std::move(other.allocator);
+            memory = other.memory;
+            count = other.count;
+
+            other.memory = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    bool operator==(const buffer_t& other) const
+    {
+        return count == other.count
+        && all_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) == std::get<1>(t); });
+    }
+
+    bool operator!=(const buffer_t& other) const
+    {
+        return count != other.count
+        || any_of(zip(*this, other), [] (const auto& t) { return std::get<0>(t) != std::get<1>(t); });
+    }
+
+    bool empty() const { return count == 0; }
+    std::size_t size() const { return count; }
+
+    const ValueType* data() const { return memory; }
+    const ValueType* begin() const { return memory; }
+    const ValueType* end() const { return memory + count; }
+    const ValueType& operator[](std::size_t offset) const { return memory[offset]; }
+    const ValueType& at(std::size_t offset) const
+    {
+        if (offset >= count)
+        {
+            throw std::out_of_range("buffer_t index out of range");
+        }
+        return memory[offset];
+    }
+
+    ValueType* data() { return memory; }
     ValueType* begin() { return memory; }
     ValueType* end() { return memory + count; }
     ValueType& operator[](std::size_t offset) { return memory[offset]; }
     ValueType& at(std::size_t offset)
     {
-        if (offset >= count)
+        if (offset >= count)
+        {
+            throw std::out_of_range("buffer_t index out of range");
+        }
+        return memory[offset];
+    }
+
+private:
+    //=========================================================================
+    ValueType* allocate(std::size_t size)
+    {
+        return size == 0 ? nullptr : std::allocator_traits<Allocator>::allocate(allocator, size);
+    }
+
+    template<typename Function>
+    void construct(Function&& constructor)
+    {
+        try {
+            constructor();
+        }
+        catch (...)
+        {
+            if (memory)
+            {
+                std::allocator_traits<Allocator>::deallocate(allocator, memory, count);
+            }
+            throw;
+        }
+    }
+
+    void release()
+    {
+        if (memory)
+        {
+            std::destroy_n(memory, count);
+            std::allocator_traits<Allocator>::deallocate(allocator, memory, count);
+        }
+        memory = nullptr;
+        count = 0;
+    }
+
+    //=========================================================================
+    Allocator allocator;
+    std::size_t count = 0;
+    ValueType* memory = nullptr;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, typename ValueType>
+class nd::double_buffer_t
+{
+public:
+
+    /**
+     * Two unique arrays for time-stepping loops: each step evaluates an
+     * update of the current array into the other one, and then swaps them.
+     * After construction, step(update) performs no heap allocations; the
+     * parallel step(update, pool) allocates only for scheduling its tiles.
+     *
+     * The current array starts as zeros, as a copy of the given initial
+     * array, or (with uninitialized) with unspecified values.
+     */
+    //=========================================================================
+    double_buffer_t(shape_t<Rank> shape)
+    : current_array(make_unique_array<ValueType>(shape))
+    , next_array(make_array(make_unique_provider<ValueType>(shape, uninitialized))) {}
+
+    double_buffer_t(shape_t<Rank> shape, uninitialized_t)
+    : current_array(make_array(make_unique_provider<ValueType>(shape, uninitialized)))
+    , next_array(make_array(make_unique_provider<ValueType>(shape, uninitialized))) {}
+
+    template<typename ArrayType>
+    double_buffer_t(const ArrayType& initial) : double_buffer_t(initial.shape(), uninitialized)
+    {
+        evaluate_into(current_array, initial);
+    }
+
+    /**
+     * Return a view of the current array. It remains valid until the next
+     * call to step, which overwrites it.
+     */
+    auto current() { return make_view(current_array.data(), current_array.shape()); }
+    auto shape() const { return current_array.shape(); }
+
+    /**
+     * Replace the current array with update(current()). The result of the
+     * update is evaluated into the other buffer, so it may freely read the
+     * current array.
+     */
+    template<typename Function>
+    void step(Function&& update)
+    {
+        evaluate_into(next_array, update(current()));
+        std::swap(current_array, next_array);
+    }
+
+    template<typename Function>
+    void step(Function&& update, thread_pool_t& pool)
+    {
+        evaluate_into(next_array, update(current()), pool);
+        std::swap(current_array, next_array);
+    }
+
+private:
+    //=========================================================================
+    array_t<unique_provider_t<Rank, ValueType>> current_array;
+    array_t<unique_provider_t<Rank, ValueType>> next_array;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, std::size_t SourceRank>
+class nd::gather_plan_t
+{
+public:
+
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    /**
+     * Make a plan from the row-major memory offsets of the elements to read
+     * from a source of the given shape, sorted for locality, and for each one
+     * its row-major position in the result (an array of the given shape).
+     */
+    gather_plan_t(shape_t<Rank> the_shape, shape_t<SourceRank> source_shape, buffer_t<std::size_t> offsets, buffer_t<std::size_t> positions)
+    : state(std::make_shared<state_t>(the_shape, source_shape, std::move(offsets), std::move(positions))) {}
+
+    auto shape() const { return state->the_shape; }
+    auto size() const { return state->the_shape.volume(); }
+    auto source_shape() const { return state->source_shape; }
+    const std::size_t* offsets() const { return state->offsets.data(); }
+    const std::size_t* positions() const { return state->positions.data(); }
+
+private:
+    //=========================================================================
+    struct state_t
+    {
+        state_t(shape_t<Rank> the_shape, shape_t<SourceRank> source_shape, buffer_t<std::size_t> offsets, buffer_t<std::size_t> positions)
+        : the_shape(the_shape)
+        , source_shape(source_shape)
+        , offsets(std::move(offsets))
+        , positions(std::move(positions))
+        {
+            if (this->offsets.size() != the_shape.volume() || this->positions.size() != the_shape.volume())
+            {
+                throw std::logic_error("a gather plan needs one offset and one position per element");
+            }
+        }
+
+        shape_t<Rank> the_shape;
+        shape_t<SourceRank> source_shape;
+        buffer_t<std::size_t> offsets;
+        buffer_t<std::size_t> positions;
+    };
+    std::shared_ptr<const state_t> state;
+};
+
+
+
+
+//=============================================================================
+// Provider factories
+//=============================================================================
+
+
+
+
+template<typename ValueType, std::size_t Rank>
+auto nd::make_uniform_provider(ValueType value, shape_t<Rank> shape)
+{
+    return uniform_provider_t<Rank, ValueType>(shape, value);
+}
+
+template<typename ValueType, typename... Args>
+auto nd::make_uniform_provider(ValueType value, Args... args)
+{
+    return make_uniform_provider(value, make_shape(args...));
+}
+
+template<typename ValueType, std::size_t Rank>
+auto nd::make_shared_provider(shape_t<Rank> shape)
+{
+    auto buffer = std::make_shared<buffer_t<ValueType>>(shape.volume());
+    return shared_provider_t<Rank, ValueType>(shape, buffer);
+}
+
+template<typename ValueType, typename... Args>
+auto nd::make_shared_provider(Args... args)
+{
+    return make_shared_provider<ValueType>(make_shape(args...));
+}
+
+template<typename ValueType, std::size_t Rank>
+auto nd::make_unique_provider(shape_t<Rank> shape)
+{
+    auto buffer = buffer_t<ValueType>(shape.volume());
+    return unique_provider_t<Rank, ValueType>(shape, std::move(buffer));
+}
+
+template<typename ValueType, std::size_t Rank>
+auto nd::make_unique_provider(shape_t<Rank> shape, uninitialized_t)
+{
+    auto buffer = buffer_t<ValueType>(shape.volume(), uninitialized);
+    return unique_provider_t<Rank, ValueType>(shape, std::move(buffer));
+}
+
+template<typename ValueType, typename... Args>
+auto nd::make_unique_provider(Args... args)
+{
+    return make_unique_provider<ValueType>(make_shape(args...));
+}
+
+template<typename Provider>
+auto nd::evaluate_as_unique(Provider&& source_provider)
+{
+    using value_type = typename std::remove_reference_t<Provider>::value_type;
+    auto target_shape = source_provider.shape();
+
+    NDARRAY_STATS_TIMER(evaluation_nanoseconds);
+    NDARRAY_STATS_ADD(evaluations, 1);
+    NDARRAY_STATS_ADD(evaluated_elements, target_shape.volume());
+    auto target_provider = make_unique_provider<value_type>(target_shape, uninitialized);
+
+    detail::evaluate_slab(source_provider, make_access_pattern(target_shape), target_provider.data());
+    return target_provider;
+}
+
+template<typename Provider>
+auto nd::evaluate_as_shared(Provider&& provider)
+{
+    return evaluate_as_unique(std::forward<Provider>(provider)).shared();
+}
+
+template<typename Provider>
+auto nd::evaluate_as_unique(Provider&& source_provider, thread_pool_t& pool)
+{
+    using value_type = typename std::remove_reference_t<Provider>::value_type;
+    auto target_shape = source_provider.shape();
+
+    NDARRAY_STATS_TIMER(evaluation_nanoseconds);
+    NDARRAY_STATS_ADD(evaluations, 1);
+    NDARRAY_STATS_ADD(evaluated_elements, target_shape.volume());
+    auto target_provider = make_unique_provider<value_type>(target_shape, uninitialized);
+    auto regions = detail::tiles_for_pool(target_shape, pool);
+
+    pool.parallel_for(regions.size(), [&] (std::size_t n)
+    {
+        detail::evaluate_region(source_provider, regions[n], target_provider.data());
+    });
+    return target_provider;
+}
+
+template<typename Provider>
+auto nd::evaluate_as_shared(Provider&& provider, thread_pool_t& pool)
+{
+    return evaluate_as_unique(std::forward<Provider>(provider), pool).shared();
+}
+
+template<typename Provider, std::size_t Rank>
+auto nd::evaluate_as_unique(Provider&& source_provider, shape_t<Rank> tile_shape)
+{
+    using value_type = typename std::remove_reference_t<Provider>::value_type;
+    auto target_shape = source_provider.shape();
+
+    NDARRAY_STATS_TIMER(evaluation_nanoseconds);
+    NDARRAY_STATS_ADD(evaluations, 1);
+    NDARRAY_STATS_ADD(evaluated_elements, target_shape.volume());
+    auto target_provider = make_unique_provider<value_type>(target_shape, uninitialized);
+
+    detail::evaluate_slab(source_provider, make_access_pattern(target_shape), tile_shape, target_provider.data());
+    return target_provider;
+}
+
+template<typename Provider, std::size_t Rank>
+auto nd::evaluate_as_shared(Provider&& provider, shape_t<Rank> tile_shape)
+{
+    return evaluate_as_unique(std::forward<Provider>(provider), tile_shape).shared();
+}
+
+template<typename Provider, std::size_t Rank>
+auto nd::evaluate_as_unique(Provider&& source_provider, thread_pool_t& pool, shape_t<Rank> tile_shape)
+{
+    using value_type = typename std::remove_reference_t<Provider>::value_type;
+    auto target_shape = source_provider.shape();
+
+    NDARRAY_STATS_TIMER(evaluation_nanoseconds);
+    NDARRAY_STATS_ADD(evaluations, 1);
+    NDARRAY_STATS_ADD(evaluated_elements, target_shape.volume());
+    auto target_provider = make_unique_provider<value_type>(target_shape, uninitialized);
+    auto regions = detail::tiles_for_pool(target_shape, pool);
+
+    pool.parallel_for(regions.size(), [&] (std::size_t n)
+    {
+        detail::evaluate_region(source_provider, regions[n], tile_shape, target_provider.data());
+    });
+    return target_provider;
+}
+
+template<typename Provider, std::size_t Rank>
+auto nd::evaluate_as_shared(Provider&& provider, thread_pool_t& pool, shape_t<Rank> tile_shape)
+{
+    return evaluate_as_unique(std::forward<Provider>(provider), pool, tile_shape).shared();
+}
+
+
+
+
+/**
+ * @brief      Evaluate an array to a shared array on the given thread pool,
+ *             without blocking the caller.
+ *
+ * @param[in]  array  The array to evaluate, which is moved into the task
+ * @param      pool   The thread pool to evaluate on; it must outlive the
+ *                    evaluation
+ *
+ * @tparam     ArrayType  The type of the array
+ *
+ * @return     A std::shared_future of the shared array; use then() to chain
+ *             further work on it, or pool.wait(future) to retrieve it
+ */
+template<typename ArrayType>
+auto nd::evaluate_async(ArrayType array, thread_pool_t& pool)
+{
+    return pool.submit([array=std::move(array), &pool]
+    {
+        return make_array(evaluate_as_shared(array.get_provider(), pool));
+    }).share();
+}
+
+
+
+
+/**
+ * @brief      Schedule a call to fn(value) on the thread pool, once the given
+ *             future is ready.
+ *
+ * @param[in]  future  The future, such as one returned by evaluate_async
+ * @param      pool    The thread pool to run the call on
+ * @param[in]  fn      The function to call with the value of the future (or
+ *                     with no arguments, for a std::shared_future<void>)
+ *
+ * @return     A std::shared_future of the result of fn
+ *
+ * @note       The call is only queued once the future is ready, so no
+ *             worker is held up waiting on it, and chains of dependent tasks
+ *             cannot deadlock the pool.
+ */
+template<typename ValueType, typename Function>
+auto nd::then(std::shared_future<ValueType> future, thread_pool_t& pool, Function fn)
+{
+    return pool.submit_after(future, [future, fn=std::move(fn)] () mutable
+    {
+        if constexpr (std::is_void<ValueType>::value)
+        {
+            future.get();
+            return fn();
+        }
+        else
+        {
+            return fn(future.get());
+        }
+    }).share();
+}
+
+
+
+
+/**
+ * @brief      Evaluate an array into the memory of an existing unique array,
+ *             without allocating.
+ *
+ * @param      target  The unique array to overwrite
+ * @param[in]  source  The array to evaluate; it must have the target's shape
+ *                     and value type
+ *
+ * @note       The source must not read from the target, since the target
+ *             is overwritten while the source is evaluated. Use
+ *             double_buffer_t for updates that depend on the previous state.
+ */
+template<typename TargetArrayType, typename SourceArrayType>
+void nd::evaluate_into(TargetArrayType& target, const SourceArrayType& source)
+{
+    detail::check_evaluation_target(target, source);
+
+    NDARRAY_STATS_TIMER(evaluation_nanoseconds);
+    NDARRAY_STATS_ADD(evaluations, 1);
+    NDARRAY_STATS_ADD(evaluated_elements, target.size());
+
+    detail::evaluate_slab(source.get_provider(), make_access_pattern(target.shape()), target.data());
+}
+
+template<typename TargetArrayType, typename SourceArrayType>
+void nd::evaluate_into(TargetArrayType& target, const SourceArrayType& source, thread_pool_t& pool)
+{
+    detail::check_evaluation_target(target, source);
+
+    NDARRAY_STATS_TIMER(evaluation_nanoseconds);
+    NDARRAY_STATS_ADD(evaluations, 1);
+    NDARRAY_STATS_ADD(evaluated_elements, target.size());
+
+    auto regions = detail::tiles_for_pool(target.shape(), pool);
+
+    pool.parallel_for(regions.size(), [&] (std::size_t n)
+    {
+        detail::evaluate_region(source.get_provider(), regions[n], target.data());
+    });
+}
+
+
+
+
+/**
+ * @brief      Evaluate an array a chunk of rows at a time, passing each chunk
+ *             to a sink, so that at most one chunk is in memory at once.
+ *
+ * @param[in]  array          The array to evaluate
+ * @param[in]  rows_per_chunk The number of indexes on axis 0 in each chunk
+ *                            (the last chunk may have fewer)
+ * @param[in]  sink           A function called as sink(region, chunk) for
+ *                            each chunk in order: region is the chunk's
+ *                            access pattern in the array, and chunk is a
+ *                            read-only view of its values, of shape
+ *                            region.shape()
+ *
+ * @note       The chunks are all evaluated into the same buffer, so the view
+ *             is only valid during the call to the sink; copy out anything
+ *             that must outlive it (e.g. with to_shared).
+ *
+ * @example    evaluate_in_chunks(A, 1024, [&] (auto region, auto chunk) { total += chunk | sum(); });
+ */
+template<typename ArrayType, typename Sink>
+void nd::evaluate_in_chunks(const ArrayType& array, std::size_t rows_per_chunk, Sink&& sink)
+{
+    detail::stream_chunks(array, rows_per_chunk, sink, [&array] (const auto& region, auto* target)
+    {
+        detail::evaluate_slab(array.get_provider(), region, target);
+    });
+}
+
+/**
+ * @brief      As above, but each chunk is evaluated on the thread pool. The
+ *             sink is still called on the calling thread, one chunk at a time.
+ */
+template<typename ArrayType, typename Sink>
+void nd::evaluate_in_chunks(const ArrayType& array, std::size_t rows_per_chunk, Sink&& sink, thread_pool_t& pool)
+{
+    detail::stream_chunks(array, rows_per_chunk, sink, [&array, &pool] (const auto& region, auto* target)
+    {
+        auto chunk_shape = region.shape();
+        auto chunk_strides = make_strides_row_major(chunk_shape);
+        auto tiles = detail::tiles_for_pool(chunk_shape, pool);
+
+        pool.parallel_for(tiles.size(), [&] (std::size_t n)
+        {
+            auto tile = tiles[n];
+            tile.start[0] += region.start[0];
+            tile.final[0] += region.start[0];
+
+            detail::for_each_row(tile, [&] (const auto& index, std::size_t count)
+            {
+                auto local = index;
+                local[0] -= region.start[0];
+                detail::evaluate_row(array.get_provider(), index, target + chunk_strides.compute_offset(local), count);
+            });
+        });
+    });
+}
+
+
+
+
+//=============================================================================
+// Array factories
+//=============================================================================
+
+
+
+
+/**
+ * @brief      Makes an array from the given provider.
+ *
+ * @param      provider  The provider
+ *
+ * @tparam     Provider  The type of the provider
+ *
+ * @return     The array
+ */
+template<typename Provider>
+constexpr auto nd::make_array(Provider&& provider)
+{
+    return array_t<Provider>(std::forward<Provider>(provider));
+}
+
+
+
+
+template<typename Mapping, std::size_t Rank>
+auto nd::make_array(Mapping mapping, shape_t<Rank> shape)
+{
+    return make_array(basic_provider_t<Mapping, Rank>(std::move(mapping), shape));
+}
+
+
+
+
+/**
+ * @brief      Makes a shared (immutable, copyable, memory-backed) array with
+ *             the given shape, initialized to the default-constructed
+ *             ValueType.
+ *
+ * @param[in]  shape      The shape
+ *
+ * @tparam     ValueType  The value type of the array
+ * @tparam     Rank       The rank of the array
+ *
+ * @return     The array
+ */
+template<typename ValueType, std::size_t Rank>
+auto nd::make_shared_array(shape_t<Rank> shape)
+{
+    return make_array(make_shared_provider<ValueType>(shape));
+}
+
+template<typename ValueType, typename... Args>
+auto nd::make_shared_array(Args... args)
+{
+    return make_array(make_shared_provider<ValueType>(args...));
+}
+
+
+
+
+/**
+ * @brief      Makes a unique (mutable, non-copyable, memory-backed) array with
+ *             the given shape.
+ *
+ * @param[in]  shape      The shape
+ *
+ * @tparam     ValueType  The value type of the array
+ * @tparam     Rank       The rank of the array
+ *
+ * @return     The array
+ */
+template<typename ValueType, std::size_t Rank>
+auto nd::make_unique_array(shape_t<Rank> shape)
+{
+    return make_array(make_unique_provider<ValueType>(shape));
+}
+
+template<typename ValueType, typename... Args>
+auto nd::make_unique_array(Args... args)
+{
+    return make_array(make_unique_provider<ValueType>(args...));
+}
+
+
+
+
+/**
+ * @brief      Makes a mutable array whose shape is fixed at compile time, and
+ *             whose elements are stored inline (no heap allocation). It is
+ *             cheap to copy, and suitable as the value type of a larger
+ *             array, e.g. a field of 3x3 tensors. Construction, indexing and
+ *             shape queries are constexpr.
+ *
+ * @param[in]  values     The elements, in row-major order (zeros by default)
+ *
+ * @tparam     ValueType  The array value type
+ * @tparam     Dims       The extent of each axis
+ *
+ * @return     The array
+ */
+template<typename ValueType, std::size_t... Dims>
+constexpr auto nd::make_static_array(std::array<ValueType, (Dims * ... * 1)> values)
+{
+    return make_array(static_provider_t<ValueType, Dims...>(values));
+}
+
+
+
+
+/**
+ * @brief      Makes an array which refers to existing memory, without copying or
+ *             taking ownership of it.
+ *
+ * @param      data       Pointer to the element at index (0, 0, ...); use a
+ *                        pointer-to-const for a read-only view
+ * @param[in]  shape      The shape
+ * @param[in]  strides    The distance, in elements, between neighboring
+ *                        elements on each axis (row-major if omitted)
+ *
+ * @tparam     ValueType  The value type of the array (may be const)
+ * @tparam     Rank       The rank of the array
+ *
+ * @return     The array. It can be copied freely, and the memory must outlive
+ *             all copies of it.
+ *
+ * @example    auto A = make_view(ptr, make_shape(10, 20), make_strides_column_major(make_shape(10, 20)));
+ */
+template<typename ValueType, std::size_t Rank>
+auto nd::make_view(ValueType* data, shape_t<Rank> shape, memory_strides_t<Rank> strides)
+{
+    return make_array(view_provider_t<Rank, ValueType>(data, shape, strides));
+}
+
+template<typename ValueType, std::size_t Rank>
+auto nd::make_view(ValueType* data, shape_t<Rank> shape)
+{
+    return make_view(data, shape, make_strides_row_major(shape));
+}
+
+
+
+
+/**
+ * @brief      Returns an index-array of the given shape, mapping the index (i,
+ *             j, ...) to itself.
+ *
+ * @param[in]  shape  The shape
+ *
+ * @tparam     Rank   The rank of the array
+ *
+ * @return     The array
+ */
+template<std::size_t Rank>
+auto nd::index_array(shape_t<Rank> shape)
+{
+    auto mapping = [shape] (auto&& index) { return index; };
+    return make_array(basic_provider_t<decltype(mapping), Rank>(mapping, shape));
+}
+
+template<typename... Args>
+auto nd::index_array(Args... args)
+{
+    return index_array(make_shape(args...));
+}
+
+
+
+
+/**
+ * @brief      Zip a sequence identically-shaped arrays together
+ *
+ * @param      arrays      The arrays
+ *
+ * @tparam     ArrayTypes  The types of the arrays
+ *
+ * @return     An array which returns tuples taken from the underlying arrays
+ */
+template<typename... ArrayTypes>
+auto nd::zip_arrays(ArrayTypes... arrays)
+{
+    constexpr std::size_t Ranks[] = {ArrayTypes::rank...};
+    shape_t<Ranks[0]> shapes[] = {arrays.shape()...};
+
+    if (std::adjacent_find(std::begin(shapes), std::end(shapes), std::not_equal_to<>()) != std::end(shapes))
+    {
+        throw std::logic_error("cannot zip arrays with different shapes");
+    }
+    return make_array(detail::zip_mapping_t<ArrayTypes...>(std::move(arrays)...), shapes[0]);
+}
+
+
+
+
+/**
+ * @brief      Return an array that is the cartesian product of the argument
+ *             arrays, A(i, j, k) == make_tuple(a(i), b(j), c(k))
+ *
+ * @param[in]  arrays      A sequence of 1d arrays
+ *
+ * @tparam     ArrayTypes  The types of the argument arrays
+ *
+ * @return     The array
+ */
+template<typename... ArrayTypes>
+auto nd::cartesian_product(ArrayTypes... arrays)
+{
+    shape_t<sizeof...(ArrayTypes)> shape = {arrays.size()...};
+
+    auto mapping = [arrays=std::make_tuple(std::move(arrays)...)] (auto&& index)
+    {
+        NDARRAY_STATS_ACCESS(cartesian_product, 1);
+        return detail::zip_apply_tuple(arrays, index.as_tuple());
+    };
+    return make_array(std::move(mapping), shape);
+}
+
+
+
+
+/**
+ * @brief      Return an array of zeros with the given shape
+ *
+ * @param[in]  args       shape arguments
+ *
+ * @tparam     ValueType  Defaults to int; use e.g. zeros<double>(...) for other
+ *                        types
+ * @tparam     Args       Argument types (should be a positive integral type)
+ *
+ * @return     An array of zeros, only requiring storage for a single element.
+ */
+template<typename ValueType, typename... Args>
+auto nd::zeros(Args... args)
+{
+    return make_array(nd::make_uniform_provider(ValueType(0), args...));
+}
+
+
+
+
+/**
+ * @brief      Return an array of ones with the given shape
+ *
+ * @param[in]  args       shape arguments
+ *
+ * @tparam     ValueType  Defaults to int; use e.g. ones<double>(...) for other
+ *                        types
+ * @tparam     Args       Argument types (should be a positive integral type)
+ *
+ * @return     An array of ones, only requiring storage for a single element.
+ */
+template<typename ValueType, typename... Args>
+auto nd::ones(Args... args)
+{
+    return make_array(nd::make_uniform_provider(ValueType(1), args...));
+}
+
+
+
+
+/**
+ * @brief      Try to promote the argument to an array of the given shape
+ *
+ * @param      arg    The argument
+ * @param[in]  shape  The shape
+ *
+ * @tparam     Arg    The argument type
+ * @tparam     Rank   The rank of the shape to promote the argument to
+ *
+ * @return     An array with the given shape
+ */
+template<typename Arg, std::size_t Rank>
+auto nd::promote(Arg arg, nd::shape_t<Rank> shape)
+{
+    if constexpr (std::is_arithmetic<Arg>::value)
+    {
+        return make_array(make_uniform_provider(arg, shape));
+    }
+    else
+    {
+        return arg;
+    }
+}
+
+
+
+
+//=============================================================================
+template<typename Function>
+struct nd::detail::vectorized_t
+{
+    template<typename... Args>
+    auto operator()(Args&&... args) const
+    {
+        return function(std::forward<Args>(args)...);
+    }
+    Function function;
+};
+
+
+
+
+//=============================================================================
+template<typename ArrayType, typename ConcatArrayType>
+class nd::detail::concat_mapping_t
+{
+public:
+
+    static constexpr std::size_t rank = ArrayType::rank;
+
+    //=========================================================================
+    concat_mapping_t(std::size_t axis_to_extend, ArrayType array, ConcatArrayType array_to_concat)
+    : axis_to_extend(axis_to_extend)
+    , array(std::move(array))
+    , array_to_concat(std::move(array_to_concat)) {}
+
+    auto operator()(index_t<rank> index) const
+    {
+        NDARRAY_STATS_ACCESS(concat, 1);
+
+        if (index[axis_to_extend] >= array.shape(axis_to_extend))
+        {
+            index[axis_to_extend] -= array.shape(axis_to_extend);
+            return array_to_concat(index);
+        }
+        return array(index);
+    }
+
+    template<typename ValueType>
+    void evaluate_row(const index_t<rank>& index, ValueType* target, std::size_t count) const
+    {
+        // The row is split where it crosses from one array into the other
+        // (only possible when extending the last axis), and each part is
+        // evaluated as a row of its own array.
+        NDARRAY_STATS_ACCESS(concat, count);
+
+        auto extent = array.shape(axis_to_extend);
+        auto split = index[axis_to_extend] >= extent ? 0 : axis_to_extend == rank - 1 ? std::min(count, extent - index[axis_to_extend]) : count;
+
+        if constexpr (std::is_same<std::decay_t<value_type_of<ArrayType>>, ValueType>::value
+                   && std::is_same<std::decay_t<value_type_of<ConcatArrayType>>, ValueType>::value)
+        {
+            auto i = index;
+
+            if (split > 0)
+            {
+                detail::evaluate_row(array.get_provider(), i, target, split);
+            }
+            if (split < count)
+            {
+                i[rank - 1] += split;
+                i[axis_to_extend] -= extent;
+                detail::evaluate_row(array_to_concat.get_provider(), i, target + split, count - split);
+            }
+        }
+        else
+        {
+            auto i = index;
+
+            for (std::size_t k = 0; k < count; ++k, ++i[rank - 1])
+            {
+                target[k] = (*this)(i);
+            }
+        }
+    }
+
+private:
+    //=========================================================================
+    std::size_t axis_to_extend;
+    ArrayType array;
+    ConcatArrayType array_to_concat;
+};
+
+
+
+
+//=============================================================================
+template<std::size_t Rank, typename ReplacementArrayType, typename PatchArrayType>
+class nd::detail::replace_mapping_t
+{
+public:
+
+    static constexpr std::size_t rank = Rank;
+
+    //=========================================================================
+    replace_mapping_t(access_pattern_t<Rank> region, ReplacementArrayType replacement_array, PatchArrayType array_to_patch)
+    : region(region)
+    , replacement_array(std::move(replacement_array))
+    , array_to_patch(std::move(array_to_patch)) {}
+
+    auto operator()(const index_t<Rank>& index) const
+    {
+        NDARRAY_STATS_ACCESS(replace, 1);
+
+        if (region.generates(index))
+        {
+            return replacement_array(region.inverse_map_index(index));
+        }
+        return array_to_patch(index);
+    }
+
+    template<typename ValueType>
+    void evaluate_row(const index_t<Rank>& index, ValueType* target, std::size_t count) const
+    {
+        // The row is split into the parts before, inside and after the
+        // region; only the middle part, if the region has unit jumps on the
+        // last axis, is read from the replacement array as a row.
+        NDARRAY_STATS_ACCESS(replace, count);
+        constexpr std::size_t L = Rank - 1;
+
+        if constexpr (std::is_same<std::decay_t<value_type_of<ReplacementArrayType>>, ValueType>::value
+                   && std::is_same<std::decay_t<value_type_of<PatchArrayType>>, ValueType>::value)
+        {
+            auto crosses = true;
+
+            for (std::size_t n = 0; n < L; ++n)
+            {
+                if (index[n] < region.start[n] || index[n] >= region.final[n] || (index[n] - region.start[n]) % region.jumps[n] != 0)
+                {
+                    crosses = false;
+                }
+            }
+            auto first = index[L];
+            auto final = index[L] + count;
+            auto a = std::max(first, region.start[L]);
+            auto b = std::min(final, region.final[L]);
+
+            if (! crosses || a >= b)
+            {
+                detail::evaluate_row(array_to_patch.get_provider(), index, target, count);
+                return;
+            }
+            auto i = index;
+
+            if (a > first)
+            {
+                detail::evaluate_row(array_to_patch.get_provider(), i, target, a - first);
+            }
+            if (region.jumps[L] == 1)
+            {
+                i[L] = a;
+                detail::evaluate_row(replacement_array.get_provider(), region.inverse_map_index(i), target + (a - first), b - a);
+            }
+            else
+            {
+                for (i[L] = a; i[L] < b; ++i[L])
+                {
+                    target[i[L] - first] = (i[L] - region.start[L]) % region.jumps[L] == 0
+                    ? replacement_array(region.inverse_map_index(i))
+                    : array_to_patch(i);
+                }
+            }
+            if (b < final)
+            {
+                i[L] = b;
+                detail::evaluate_row(array_to_patch.get_provider(), i, target + (b - first), final - b);
+            }
+        }
+        else
+        {
+            auto i = index;
+
+            for (std::size_t k = 0; k < count; ++k, ++i[L])
+            {
+                target[k] = (*this)(i);
+            }
+        }
+    }
+
+private:
+    //=========================================================================
+    access_pattern_t<Rank> region;
+    ReplacementArrayType replacement_array;
+    PatchArrayType array_to_patch;
+};
+
+
+
+
+//=============================================================================
+template<typename... ArrayTypes>
+class nd::detail::zip_mapping_t
+{
+public:
+
+    static constexpr std::size_t rank = std::tuple_element_t<0, std::tuple<ArrayTypes...>>::rank;
+
+    //=========================================================================
+    zip_mapping_t(ArrayTypes... arrays) : arrays(std::move(arrays)...) {}
+
+    auto operator()(const index_t<rank>& index) const
+    {
+        NDARRAY_STATS_ACCESS(zip_arrays, 1);
+        return std::apply([&index] (const auto&... a) { return std::make_tuple(a(index)...); }, arrays);
+    }
+
+    template<typename ValueType>
+    void evaluate_row(const index_t<rank>& index, ValueType* target, std::size_t count) const
+    {
+        NDARRAY_STATS_ACCESS(zip_arrays, count);
+        evaluate_row(index, target, count, std::index_sequence_for<ArrayTypes...>());
+    }
+
+    const auto& get_arrays() const { return arrays; }
+
+private:
+    //=========================================================================
+    template<typename ValueType, std::size_t... Is>
+    void evaluate_row(const index_t<rank>& index, ValueType* target, std::size_t count, std::index_sequence<Is...>) const
+    {
+        // Each array's row is read a block at a time, and the blocks are
+        // zipped together into the target.
+        if constexpr ((std::is_default_constructible<std::decay_t<value_type_of<ArrayTypes>>>::value && ...))
+        {
+            auto blocks = std::tuple<std::array<std::decay_t<value_type_of<ArrayTypes>>, row_block_size>...>();
+            auto start = index;
+
+            for (std::size_t k = 0; k < count; k += row_block_size)
+            {
+                auto n = std::min(row_block_size, count - k);
+                start[rank - 1] = index[rank - 1] + k;
+
+                auto rows = std::make_tuple(read_row(std::get<Is>(arrays).get_provider(), start, std::get<Is>(blocks).data(), n)...);
+
+                for (std::size_t j = 0; j < n; ++j)
+                {
+                    target[k + j] = ValueType(std::get<Is>(rows)[j]...);
+                }
+            }
+        }
+        else
+        {
+            auto i = index;
+
+            for (std::size_t k = 0; k < count; ++k, ++i[rank - 1])
+            {
+                target[k] = (*this)(i);
+            }
+        }
+    }
+
+    std::tuple<ArrayTypes...> arrays;
+};
+
+
+
+
+//=============================================================================
+template<typename ArrayType, typename Function>
+class nd::detail::transform_mapping_t
+{
+public:
+
+    static constexpr std::size_t rank = ArrayType::rank;
+
+    //=========================================================================
+    transform_mapping_t(ArrayType array, Function function) : array(std::move(array)), function(std::move(function)) {}
+
+    auto operator()(const index_t<rank>& index) const
+    {
+        NDARRAY_STATS_ACCESS(transform, 1);
+        return function(array(index));
+    }
+
+    template<typename ValueType>
+    void evaluate_row(const index_t<rank>& index, ValueType* target, std::size_t count) const
+    {
+        using operand_type = std::decay_t<value_type_of<ArrayType>>;
+        NDARRAY_STATS_ACCESS(transform, count);
+
+        if constexpr (std::is_default_constructible<operand_type>::value)
+        {
+            operand_type block[row_block_size];
+            auto start = index;
+
+            for (std::size_t k = 0; k < count; k += row_block_size)
+            {
+                auto n = std::min(row_block_size, count - k);
+                start[rank - 1] = index[rank - 1] + k;
+                detail::apply_elementwise(function, target + k, n, detail::read_row(array.get_provider(), start, block, n));
+            }
+        }
+        else
+        {
+            auto i = index;
+
+            for (std::size_t k = 0; k < count; ++k, ++i[rank - 1])
+            {
+                target[k] = function(array(i));
+            }
+        }
+    }
+
+private:
+    //=========================================================================
+    ArrayType array;
+    Function function;
+};
+
+
+
+
+//=============================================================================
+template<typename Function, typename ArrayTypeA, typename ArrayTypeB>
+class nd::detail::binary_op_mapping_t
+{
+public:
+
+    static constexpr std::size_t rank = ArrayTypeA::rank;
+
+    //=========================================================================
+    binary_op_mapping_t(Function function, ArrayTypeA A, ArrayTypeB B) : function(std::move(function)), A(std::move(A)), B(std::move(B)) {}
+
+    auto operator()(const index_t<rank>& index) const
+    {
+        NDARRAY_STATS_ACCESS(binary_op, 1);
+        return function(A(index), B(index));
+    }
+
+    template<typename ValueType>
+    void evaluate_row(const index_t<rank>& index, ValueType* target, std::size_t count) const
+    {
+        using operand_type_a = std::decay_t<value_type_of<ArrayTypeA>>;
+        using operand_type_b = std::decay_t<value_type_of<ArrayTypeB>>;
+        NDARRAY_STATS_ACCESS(binary_op, count);
+
+        if constexpr (
+            std::is_default_constructible<operand_type_a>::value &&
+            std::is_default_constructible<operand_type_b>::value)
+        {
+            operand_type_a block_a[row_block_size];
+            operand_type_b block_b[row_block_size];
+            auto start = index;
+
+            // A uniform operand is folded to a scalar: its block is filled
+            // once, rather than read for each block of the row.
+            if constexpr (is_uniform_v<ArrayTypeA>)
+            {
+                std::fill_n(block_a, std::min(row_block_size, count), A(index));
+            }
+            if constexpr (is_uniform_v<ArrayTypeB>)
+            {
+                std::fill_n(block_b, std::min(row_block_size, count), B(index));
+            }
+
+            for (std::size_t k = 0; k < count; k += row_block_size)
+            {
+                auto n = std::min(row_block_size, count - k);
+                start[rank - 1] = index[rank - 1] + k;
+                detail::apply_elementwise(function, target + k, n,
+                    is_uniform_v<ArrayTypeA> ? block_a : detail::read_row(A.get_provider(), start, block_a, n),
+                    is_uniform_v<ArrayTypeB> ? block_b : detail::read_row(B.get_provider(), start, block_b, n));
+            }
+        }
+        else
+        {
+            auto i = index;
+
+            for (std::size_t k = 0; k < count; ++k, ++i[rank - 1])
+            {
+                target[k] = function(A(i), B(i));
+            }
+        }
+    }
+
+private:
+    //=========================================================================
+    Function function;
+    ArrayTypeA A;
+    ArrayTypeB B;
+};
+
+
+
+
+//=============================================================================
+struct nd::detail::sum_reduction_t
+{
+    template<typename ArrayType>
+    auto operator()(ArrayType&& array) const
+    {
+        using value_type = nd::value_type_of<decltype(array)>;
+        using is_boolean = std::is_same<value_type, bool>;
+        using result_type = std::conditional_t<is_boolean::value, unsigned long, value_type>;
+
+        return detail::sum_region<result_type>(array, array.indexes());
+    }
+};
+
+
+
+
+//=============================================================================
+template<typename ArrayType>
+class nd::detail::axis_sum_mapping_t
+{
+public:
+
+    using operand_type = std::decay_t<value_type_of<ArrayType>>;
+    using value_type = std::conditional_t<std::is_same<operand_type, bool>::value, unsigned long, operand_type>;
+    static constexpr std::size_t rank = ArrayType::rank - 1;
+
+    //=========================================================================
+    axis_sum_mapping_t(ArrayType array, std::size_t axis) : array(std::move(array)), axis(axis) {}
+
+    value_type operator()(const index_t<rank>& index) const
+    {
+        auto result = value_type();
+        evaluate_row(index, &result, 1);
+        return result;
+    }
+
+    void evaluate_row(const index_t<rank>& index, value_type* target, std::size_t count) const
+    {
+        constexpr std::size_t R = ArrayType::rank;
+        auto source_index = index.insert_elements(make_index(axis), make_index(0));
+        NDARRAY_STATS_ACCESS(collect, count);
+
+        if (axis == R - 1 || ! std::is_default_constructible<operand_type>::value)
+        {
+            // Each target element is the sum of a separate line of the
+            // source, which is read one row (or one element) at a time.
+            auto line = access_pattern_t<R>().with_start(source_index).with_final(source_index);
+
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                for (std::size_t n = 0; n < R; ++n)
+                {
+                    line.final[n] = line.start[n] + (n == axis ? array.shape(axis) : 1);
+                }
+                target[k] = sum_region<value_type>(array, line);
+                ++line.start[axis == R - 1 ? R - 2 : R - 1];
+            }
+        }
+        else if constexpr (std::is_default_constructible<operand_type>::value)
+        {
+            // The target row lies along the source's last axis; source rows
+            // are added to it in turn, sweeping once over the reduced axis.
+            operand_type block[row_block_size];
+            value_type sum[row_block_size];
+            value_type compensation[row_block_size];
+
+            for (std::size_t k = 0; k < count; k += row_block_size)
+            {
+                auto n = std::min(row_block_size, count - k);
+                std::fill(sum, sum + n, value_type());
+                std::fill(compensation, compensation + n, value_type());
+                source_index[R - 1] = index[rank - 1] + k;
+
+                for (std::size_t a = 0; a < array.shape(axis); ++a)
+                {
+                    source_index[axis] = a;
+                    auto row = read_row(array.get_provider(), source_index, block, n);
+
+                    for (std::size_t j = 0; j < n; ++j)
+                    {
+                        if constexpr (std::is_floating_point<value_type>::value)
+                        {
+                            auto y = value_type(row[j]) - compensation[j];
+                            auto t = sum[j] + y;
+                            compensation[j] = (t - sum[j]) - y;
+                            sum[j] = t;
+                        }
+                        else
+                        {
+                            sum[j] += row[j];
+                        }
+                    }
+                }
+                std::copy(sum, sum + n, target + k);
+            }
+        }
+    }
+
+private:
+    //=========================================================================
+    ArrayType array;
+    std::size_t axis;
+};
+
+
+
+
+//=============================================================================
+template<typename ArrayType, typename WeightType>
+class nd::detail::stencil_mapping_t
+{
+public:
+
+    using operand_type = std::decay_t<value_type_of<ArrayType>>;
+    using value_type = std::decay_t<decltype(std::declval<WeightType>() * std::declval<operand_type>())>;
+    static constexpr std::size_t rank = ArrayType::rank;
+    using tap_group_t = stencil_tap_group_t<rank, WeightType>;
+
+    //=========================================================================
+    stencil_mapping_t(ArrayType array, std::vector<tap_group_t> groups, std::size_t kernel_length)
+    : array(std::move(array))
+    , groups(std::move(groups))
+    , kernel_length(kernel_length) {}
+
+    value_type operator()(const index_t<rank>& index) const
+    {
+        auto result = value_type();
+        NDARRAY_STATS_ACCESS(stencil, 1);
+
+        for (const auto& group : groups)
+        {
+            auto i = index;
+
+            for (std::size_t n = 0; n < rank; ++n)
+            {
+                i[n] += group.offset[n];
+            }
+            for (const auto& [k, w] : group.taps)
+            {
+                auto j = i;
+                j[rank - 1] += k;
+                result += w * array(j);
+            }
+        }
+        return result;
+    }
+
+    void evaluate_row(const index_t<rank>& index, value_type* target, std::size_t count) const
+    {
+        if constexpr (std::is_default_constructible<operand_type>::value)
+        {
+            if (kernel_length <= row_block_size)
+            {
+                NDARRAY_STATS_ACCESS(stencil, count);
+                // Each group reads one operand row spanning the outputs and
+                // their neighbours along the last axis, and each of its taps
+                // adds a shifted copy of that row.
+                operand_type block[2 * row_block_size];
+                value_type sum[row_block_size];
+
+                for (std::size_t k = 0; k < count; k += row_block_size)
+                {
+                    auto n = std::min(row_block_size, count - k);
+                    std::fill(sum, sum + n, value_type());
+
+                    for (const auto& group : groups)
+                    {
+                        auto i = index;
+
+                        for (std::size_t m = 0; m < rank; ++m)
+                        {
+                            i[m] += group.offset[m];
+                        }
+                        i[rank - 1] += k;
+
+                        auto row = read_row(array.get_provider(), i, block, n + kernel_length - 1);
+
+                        for (const auto& [shift, w] : group.taps)
+                        {
+                            for (std::size_t j = 0; j < n; ++j)
+                            {
+                                sum[j] += w * row[j + shift];
+                            }
+                        }
+                    }
+                    std::copy(sum, sum + n, target + k);
+                }
+                return;
+            }
+        }
+        auto i = index;
+
+        for (std::size_t k = 0; k < count; ++k, ++i[rank - 1])
+        {
+            target[k] = operator()(i);
+        }
+    }
+
+private:
+    //=========================================================================
+    ArrayType array;
+    std::vector<tap_group_t> groups;
+    std::size_t kernel_length;
+};
+
+
+
+
+//=============================================================================
+template<typename IndexArrayType, typename ArrayType>
+class nd::detail::gather_mapping_t
+{
+public:
+
+    using index_type = std::decay_t<value_type_of<IndexArrayType>>;
+    using value_type = std::decay_t<value_type_of<ArrayType>>;
+    using provider_type = typename ArrayType::provider_type;
+    static constexpr std::size_t rank = IndexArrayType::rank;
+    static constexpr std::size_t source_rank = ArrayType::rank;
+
+    static_assert(std::is_integral<index_type>::value || std::is_same<index_type, index_t<source_rank>>::value,
+        "read_indexes needs an array of index_t's of the operand's rank, or of row-major memory offsets");
+
+    //=========================================================================
+    gather_mapping_t(IndexArrayType indexes, ArrayType array)
+    : indexes(std::move(indexes))
+    , array(std::move(array))
+    , strides(make_strides_row_major(this->array.shape())) {}
+
+    value_type operator()(const index_t<rank>& index) const
+    {
+        NDARRAY_STATS_ACCESS(read_indexes, 1);
+        return array(source_index(indexes(index)));
+    }
+
+    void evaluate_row(const index_t<rank>& index, value_type* target, std::size_t count) const
+    {
+        if constexpr (is_row_major_memory_provider<provider_type>::value || is_strided_memory_provider<provider_type>::value)
+        {
+            // A block of indexes is turned into memory offsets, prefetching
+            // each element, before any element is loaded: the cache misses of
+            // a block then overlap, rather than each load waiting on the last.
+            // A strided view with no data pointer (a positive shift) is read
+            // an element at a time instead.
+            if (auto memory = array.data())
+            {
+                NDARRAY_STATS_ACCESS(read_indexes, count);
+                index_type block[row_block_size];
+                std::size_t offsets[row_block_size];
+                auto start = index;
+
+                for (std::size_t k = 0; k < count; k += row_block_size)
+                {
+                    auto n = std::min(row_block_size, count - k);
+                    start[rank - 1] = index[rank - 1] + k;
+                    auto row = read_row(indexes.get_provider(), start, block, n);
+
+                    for (std::size_t j = 0; j < n; ++j)
+                    {
+                        offsets[j] = memory_offset(row[j]);
+                        NDARRAY_PREFETCH(memory + offsets[j]);
+                    }
+                    for (std::size_t j = 0; j < n; ++j)
+                    {
+                        target[k + j] = memory[offsets[j]];
+                    }
+                }
+                return;
+            }
+        }
+        auto i = index;
+
+        for (std::size_t k = 0; k < count; ++k, ++i[rank - 1])
+        {
+            target[k] = operator()(i);
+        }
+    }
+
+private:
+    //=========================================================================
+    index_t<source_rank> source_index(const index_type& i) const
+    {
+        if constexpr (std::is_integral<index_type>::value)
+        {
+            return index_at_offset(std::size_t(i), strides);
+        }
+        else
+        {
+            return i;
+        }
+    }
+
+    std::size_t memory_offset(const index_type& i) const
+    {
+        if constexpr (is_row_major_memory_provider<provider_type>::value)
+        {
+            if constexpr (std::is_integral<index_type>::value)
+            {
+                return std::size_t(i);
+            }
+            else
+            {
+                return strides.compute_offset(i);
+            }
+        }
+        else
+        {
+            return array.get_provider().strides().compute_offset(source_index(i));
+        }
+    }
+
+    IndexArrayType indexes;
+    ArrayType array;
+    memory_strides_t<source_rank> strides;
+};
+
+
+
+
+//=============================================================================
+// Operator factories
+//=============================================================================
+
+
+
+
+/**
+ * @brief      Return an operator that attempts to reshape its argument array to
+ *             the given shape.
+ *
+ * @param[in]  new_shape  The new shape
+ *
+ * @tparam     Rank       The rank of the argument array
+ *
+ * @return     The operator
+ */
+template<std::size_t Rank>
+auto nd::reshape(shape_t<Rank> new_shape)
+{
+    return [new_shape] (auto&& array)
+    {
+        const auto& provider = array.get_provider();
+
+        if (new_shape.volume() != provider.size())
+        {
+            throw std::logic_error("cannot reshape array to a different size");
+        }
+        return make_array(provider.reshape(new_shape));
+    };
+}
+
+template<typename... Args>
+auto nd::reshape(Args... args)
+{
+    return reshape(make_shape(args...));
+}
+
+
+
+
+/**
+ * @brief      Return an operator that permutes the axes of its argument
+ *             array: axis n of the result is axis axes[n] of the argument, so
+ *             permute_axes(1, 0) transposes a matrix.
+ *
+ * @param[in]  axes   A permutation of the argument array's axes
+ *
+ * @tparam     Rank   The rank of the argument array
+ *
+ * @return     The operator
+ *
+ * @note       Permuting a shared array, a view, or a memory-mapped array only
+ *             permutes its strides, without copying; a unique array is first
+ *             made shared (moving its buffer, if it is an rvalue). Evaluating
+ *             the result copies it in blocks, so that the memory read for each
+ *             block is re-used.
+ */
+template<std::size_t Rank>
+auto nd::permute_axes(index_t<Rank> axes)
+{
+    auto seen = std::array<bool, Rank>();
+
+    for (std::size_t n = 0; n < Rank; ++n)
+    {
+        if (axes[n] >= Rank || seen[axes[n]])
+        {
+            throw std::logic_error("permute_axes needs a permutation of the array's axes");
+        }
+        seen[axes[n]] = true;
+    }
+
+    return [axes] (auto&& array)
+    {
+        using provider_type = typename std::decay_t<decltype(array)>::provider_type;
+        static_assert(provider_type::rank == Rank, "permute_axes needs one entry per axis of the array");
+
+        auto shape = shape_t<Rank>();
+
+        for (std::size_t n = 0; n < Rank; ++n)
+        {
+            shape[n] = array.shape(axes[n]);
+        }
+
+        if constexpr (detail::is_unique_provider<provider_type>::value)
+        {
+            return std::forward<decltype(array)>(array).shared() | permute_axes(axes);
+        }
+        else if constexpr (detail::is_strided_memory_provider<provider_type>::value || detail::is_mmap_provider<provider_type>::value)
+        {
+            auto source_strides = [&array]
+            {
+                if constexpr (detail::is_mmap_provider<provider_type>::value)
+                {
+                    return make_strides_row_major(array.shape());
+                }
+                else
+                {
+                    return array.get_provider().strides();
+                }
+            }();
+            auto strides = memory_strides_t<Rank>();
+
+            for (std::size_t n = 0; n < Rank; ++n)
+            {
+                strides[n] = source_strides[axes[n]];
+            }
+            return make_array(array.get_provider().with_layout(shape, strides, 0));
+        }
+        else
+        {
+            auto mapping = [axes, array=std::forward<decltype(array)>(array)] (const index_t<Rank>& index)
+            {
+                NDARRAY_STATS_ACCESS(permute_axes, 1);
+                auto source_index = index_t<Rank>();
+
+                for (std::size_t n = 0; n < Rank; ++n)
+                {
+                    source_index[axes[n]] = index[n];
+                }
+                return array(source_index);
+            };
+            return make_array(std::move(mapping), shape);
+        }
+    };
+}
+
+template<typename... Args>
+auto nd::permute_axes(Args... args)
+{
+    return permute_axes(make_index(args...));
+}
+
+
+
+
+/**
+ * @brief      Returns an operator that, applied to any array will yield a
+ *             shared, memory-backed version of that array.
+ *
+ * @return     The operator.
+ */
+auto nd::to_shared()
+{
+    return [] (auto&& array)
+    {
+        return make_array(evaluate_as_shared(array.get_provider()));
+    };
+}
+
+
+
+
+/**
+ * @brief      Returns an operator that, applied to any array will yield a
+ *             unique, memory-backed version of that array.
+ *
+ * @return     The operator.
+ */
+auto nd::to_unique()
+{
+    return [] (auto&& array)
+    {
+        return make_array(evaluate_as_unique(array.get_provider()));
+    };
+}
+
+
+
+
+/**
+ * @brief      Returns an operator that, applied to any array will yield a
+ *             shared, memory-backed version of that array, evaluated on the
+ *             worker threads of the given pool.
+ *
+ * @param      pool  The thread pool to evaluate on; it must outlive the
+ *                   operator
+ *
+ * @return     The operator.
+ */
+auto nd::to_shared_parallel(thread_pool_t& pool)
+{
+    return [&pool] (auto&& array)
+    {
+        return make_array(evaluate_as_shared(array.get_provider(), pool));
+    };
+}
+
+
+
+
+/**
+ * @brief      Returns an operator that, applied to any array will yield a
+ *             unique, memory-backed version of that array, evaluated on the
+ *             worker threads of the given pool.
+ *
+ * @param      pool  The thread pool to evaluate on; it must outlive the
+ *                   operator
+ *
+ * @return     The operator.
+ */
+auto nd::to_unique_parallel(thread_pool_t& pool)
+{
+    return [&pool] (auto&& array)
+    {
+        return make_array(evaluate_as_unique(array.get_provider(), pool));
+    };
+}
+
+
+
+
+/**
+ * @brief      Synonym for to_shared_parallel.
+ *
+ * @param      pool  The thread pool to evaluate on
+ *
+ * @return     The operator.
+ */
+auto nd::evaluate_on(thread_pool_t& pool)
+{
+    return to_shared_parallel(pool);
+}
+
+
+
+/**
+ * @brief      Returns an operator that, applied to any array will yield a
+ *             shared, memory-backed version of that array, evaluated one tile
+ *             at a time.
+ *
+ * @param      tile_shape  The largest block of indexes to evaluate at once
+ *
+ * @return     The operator.
+ *
+ * @note       Tiling helps when the array reads its operands out of row-major
+ *             order, for example after a transpose or an axis reduction.
+ */
+template<std::size_t Rank>
+auto nd::to_shared(shape_t<Rank> tile_shape)
+{
+    return [tile_shape] (auto&& array)
+    {
+        return make_array(evaluate_as_shared(array.get_provider(), tile_shape));
+    };
+}
+
+
+
+
+/**
+ * @brief      Returns an operator that, applied to any array will yield a
+ *             unique, memory-backed version of that array, evaluated one tile
+ *             at a time.
+ *
+ * @param      tile_shape  The largest block of indexes to evaluate at once
+ *
+ * @return     The operator.
+ */
+template<std::size_t Rank>
+auto nd::to_unique(shape_t<Rank> tile_shape)
+{
+    return [tile_shape] (auto&& array)
+    {
+        return make_array(evaluate_as_unique(array.get_provider(), tile_shape));
+    };
+}
+
+
+
+
+/**
+ * @brief      As to_shared_parallel, but each worker evaluates its part of the
+ *             array one tile at a time.
+ *
+ * @param      pool        The thread pool to evaluate on; it must outlive the
+ *                         operator
+ * @param      tile_shape  The largest block of indexes to evaluate at once
+ *
+ * @return     The operator.
+ */
+template<std::size_t Rank>
+auto nd::to_shared_parallel(thread_pool_t& pool, shape_t<Rank> tile_shape)
+{
+    return [&pool, tile_shape] (auto&& array)
+    {
+        return make_array(evaluate_as_shared(array.get_provider(), pool, tile_shape));
+    };
+}
+
+
+
+
+/**
+ * @brief      As to_unique_parallel, but each worker evaluates its part of the
+ *             array one tile at a time.
+ *
+ * @param      pool        The thread pool to evaluate on; it must outlive the
+ *                         operator
+ * @param      tile_shape  The largest block of indexes to evaluate at once
+ *
+ * @return     The operator.
+ */
+template<std::size_t Rank>
+auto nd::to_unique_parallel(thread_pool_t& pool, shape_t<Rank> tile_shape)
+{
+    return [&pool, tile_shape] (auto&& array)
+    {
+        return make_array(evaluate_as_unique(array.get_provider(), pool, tile_shape));
+    };
+}
+
+
+
+
+/**
+ * @brief      Return an operator that turns an array into a bounds-checking
+ *             array.
+ *
+ * @return     The array
+ */
+auto nd::bounds_check()
+{
+    return [] (auto&& array)
+    {
+        auto shape = array.shape();
+        auto mapping = [array=std::forward<decltype(array)>(array)] (auto&& index)
+        {
+            if (! array.shape().contains(index))
+            {
+                throw std::out_of_range("index out-of-range");
+            }
+            return array(index);
+        };
+        return make_array(std::move(mapping), shape);
+    };
+}
+
+
+
+
+/**
+ * @brief      Return an operator that sums the elements of an array.
+ *
+ * @return     The operator
+ *
+ * @note       The return type is the same as the array value type, except if
+ *             it's bool - in which case the return type is unsigned long.
+ *             Floating-point sums are Kahan-compensated.
+ */
+auto nd::sum()
+{
+    return detail::sum_reduction_t();
+}
+
+
+
+
+/**
+ * @brief      Return a reduce operator that returns true if all of its
+ *             argument array's elements evaluate to true.
+ *
+ * @return     The operator
+ */
+auto nd::all()
+{
+    return [] (auto&& array)
+    {
+        for (const auto& i : array.indexes()) if (! array(i)) return false;
+        return true;
+    };
+}
+
+
+
+
+/**
+ * @brief      Return a reduce operator that returns true if any of its
+ *             argument array's elements evaluate to true.
+ *
+ * @return     The operator
+ */
+auto nd::any()
+{
+    return [] (auto&& array)
+    {
+        for (const auto& i : array.indexes()) if (array(i)) return true;
+        return false;
+    };
+}
+
+
+
+
+/**
+ * @brief      Return an operator that sums the elements of an array, using the
+ *             worker threads of the given pool.
+ *
+ * @param      pool  The thread pool to evaluate on
+ *
+ * @return     The operator
+ *
+ * @note       The result type follows that of sum(). Floating-point partial
+ *             sums are Kahan-compensated and then combined pairwise.
+ */
+auto nd::sum_on(thread_pool_t& pool)
+{
+    return [&pool] (auto&& array)
+    {
+        using value_type = nd::value_type_of<decltype(array)>;
+        using is_boolean = std::is_same<value_type, bool>;
+        using result_type = std::conditional_t<is_boolean::value, unsigned long, value_type>;
+
+        auto regions = detail::tiles_for_pool(array.shape(), pool);
+        auto partials = std::vector<result_type>(regions.size());
+
+        pool.parallel_for(regions.size(), [&] (std::size_t n)
+        {
+            partials[n] = detail::sum_region<result_type>(array, regions[n]);
+        });
+        return detail::reduce_pairwise(std::move(partials), std::plus<>(), result_type());
+    };
+}
+
+
+
+/**
+ * @brief      Return an operator that sums the elements of an array, visiting
+ *             them one tile at a time.
+ *
+ * @param      tile_shape  The largest block of indexes to visit at once
+ *
+ * @return     The operator
+ *
+ * @note       The result type follows that of sum(). The sums of the tiles
+ *             are combined pairwise.
+ */
+template<std::size_t Rank>
+auto nd::sum(shape_t<Rank> tile_shape)
+{
+    return [tile_shape] (auto&& array)
+    {
+        using value_type = nd::value_type_of<decltype(array)>;
+        using is_boolean = std::is_same<value_type, bool>;
+        using result_type = std::conditional_t<is_boolean::value, unsigned long, value_type>;
+
+        return detail::sum_tiles<result_type>(array, array.indexes(), tile_shape);
+    };
+}
+
+
+
+
+/**
+ * @brief      Return an operator that sums the elements of an array using the
+ *             worker threads of the given pool, each of which visits its part
+ *             of the array one tile at a time.
+ *
+ * @param      pool        The thread pool to evaluate on
+ * @param      tile_shape  The largest block of indexes to visit at once
+ *
+ * @return     The operator
+ */
+template<std::size_t Rank>
+auto nd::sum_on(thread_pool_t& pool, shape_t<Rank> tile_shape)
+{
+    return [&pool, tile_shape] (auto&& array)
+    {
+        using value_type = nd::value_type_of<decltype(array)>;
+        using is_boolean = std::is_same<value_type, bool>;
+        using result_type = std::conditional_t<is_boolean::value, unsigned long, value_type>;
+
+        auto regions = detail::tiles_for_pool(array.shape(), pool);
+        auto partials = std::vector<result_type>(regions.size());
+
+        pool.parallel_for(regions.size(), [&] (std::size_t n)
+        {
+            partials[n] = detail::sum_tiles<result_type>(array, regions[n], tile_shape);
+        });
+        return detail::reduce_pairwise(std::move(partials), std::plus<>(), result_type());
+    };
+}
+
+
+
+
+/**
+ * @brief      Return a reduce operator that returns true if all of its
+ *             argument array's elements evaluate to true, using the worker
+ *             threads of the given pool. All workers stop as soon as any of
+ *             them finds a false element.
+ *
+ * @param      pool  The thread pool to evaluate on
+ *
+ * @return     The operator
+ */
+auto nd::all_on(thread_pool_t& pool)
+{
+    return [&pool] (auto&& array)
+    {
+        auto regions = detail::tiles_for_pool(array.shape(), pool);
+        auto found_false = std::atomic<bool>(false);
+
+        pool.parallel_for(regions.size(), [&] (std::size_t n)
         {
-            throw std::out_of_range("buffer_t index out of range");
-        }
-        return memory[offset];
-    }
+            for (const auto& i : regions[n])
+            {
+                if (found_false.load(std::memory_order_relaxed))
+                {
+                    return;
+                }
+                if (! array(i))
+                {
+                    found_false = true;
+                    return;
+                }
+            }
+        });
+        return ! found_false.load();
+    };
+}
 
-private:
-    //=========================================================================
-    std::size_t count = 0;
-    ValueType* memory = nullptr;
-};
 
 
 
+/**
+ * @brief      Return a reduce operator that returns true if any of its
+ *             argument array's elements evaluate to true, using the worker
+ *             threads of the given pool. All workers stop as soon as any of
+ *             them finds a true element.
+ *
+ * @param      pool  The thread pool to evaluate on
+ *
+ * @return     The operator
+ */
+auto nd::any_on(thread_pool_t& pool)
+{
+    return [&pool] (auto&& array)
+    {
+        auto regions = detail::tiles_for_pool(array.shape(), pool);
+        auto found_true = std::atomic<bool>(false);
 
-//=============================================================================
-// Provider factories
-//=============================================================================
+        pool.parallel_for(regions.size(), [&] (std::size_t n)
+        {
+            for (const auto& i : regions[n])
+            {
+                if (found_true.load(std::memory_order_relaxed))
+                {
+                    return;
+                }
+                if (array(i))
+                {
+                    found_true = true;
+                    return;
+                }
+            }
+        });
+        return found_true.load();
+    };
+}
 
 
 
 
-template<typename ValueType, std::size_t Rank>
-auto nd::make_uniform_provider(ValueType value, shape_t<Rank> shape)
+/**
+ * @brief      Return an operator that reduces the elements of an array with a
+ *             binary function, using the worker threads of the given pool.
+ *
+ * @param      pool      The thread pool to evaluate on
+ * @param      function  The binary function, called as function(a, b); it
+ *                       must be associative, since elements are grouped
+ *                       differently than in a serial left fold
+ * @param      identity  The identity element of the function (e.g. 0 for
+ *                       addition); each partial reduction starts from it
+ *
+ * @tparam     Function   The function type
+ * @tparam     ValueType  The result type of the reduction
+ *
+ * @return     The operator
+ */
+template<typename Function, typename ValueType>
+auto nd::reduce_on(thread_pool_t& pool, Function function, ValueType identity)
 {
-    return uniform_provider_t<Rank, ValueType>(shape, value);
+    return [&pool, function, identity] (auto&& array)
+    {
+        auto regions = detail::partition_for_pool(array.shape(), pool);
+        auto partials = std::vector<ValueType>(regions.size(), identity);
+
+        pool.parallel_for(regions.size(), [&] (std::size_t n)
+        {
+            auto result = identity;
+
+            for (const auto& i : regions[n])
+            {
+                result = function(result, array(i));
+            }
+            partials[n] = result;
+        });
+        return detail::reduce_pairwise(std::move(partials), function, identity);
+    };
 }
 
-template<typename ValueType, typename... Args>
-auto nd::make_uniform_provider(ValueType value, Args... args)
+
+
+
+/**
+ * @brief      Return an operator that shifts an array along an axis
+ *
+ * @param[in]  delta  The amount to shift by
+ *
+ * @return     The operator
+ * 
+ * @example    B = A | shift_by(-2).along_axis(1); // B(i, j) == A(i, j + 2)
+ */
+auto nd::shift_by(int delta)
 {
-    return make_uniform_provider(value, make_shape(args...));
+    return shifter_t(0, delta);
 }
 
-template<typename ValueType, std::size_t Rank>
-auto nd::make_shared_provider(shape_t<Rank> shape)
+
+
+
+/**
+ * @brief      Return an operator that freezes one index its argument array,
+ *             reducing its rank by 1.
+ *
+ * @param[in]  axis_to_freeze  The axis to freeze
+ *
+ * @return     The operator
+ */
+auto nd::freeze_axis(std::size_t axis_to_freeze)
 {
-    auto buffer = std::make_shared<buffer_t<ValueType>>(shape.volume());
-    return shared_provider_t<Rank, ValueType>(shape, buffer);
+    return axis_freezer_t<1>(make_index(axis_to_freeze));
 }
 
-template<typename ValueType, typename... Args>
-auto nd::make_shared_provider(Args... args)
+
+
+
+/**
+ * @brief      Return a reducer operator, which can apply the given operator
+ *             along a given axis
+ *
+ * @param      reduction     The reduction
+ *
+ * @tparam     OperatorType  The type of function object to be applied along an
+ *                           axis
+ *
+ * @return     The operator
+ *
+ * @note       Unless the array is memory-backed, the 1d array passed to the
+ *             reduction refers to the array being reduced without copying it.
+ *             A reduction may return a lazy array of its argument, which then
+ *             shares ownership of the array being reduced.
+ */
+template<typename OperatorType>
+auto nd::collect(OperatorType reduction)
 {
-    return make_shared_provider<ValueType>(make_shape(args...));
+    return axis_reducer_t<OperatorType>(0, std::forward<OperatorType>(reduction));
 }
 
-template<typename ValueType, std::size_t Rank>
-auto nd::make_unique_provider(shape_t<Rank> shape)
+
+
+
+/**
+ * @brief      Return an operator that concats the given array onto another.
+ *
+ * @param      array_to_concat  The array to concatenate
+ *
+ * @tparam     ArrayType        The type of the array to concatenate
+ *
+ * @return     The operator
+ *
+ * @note       The returned operator will fail to compile if applied to arrays
+ *             of a different rank than the array to concatenate. It will throw
+ *             a logic_error if the array shapes are incompatible.
+ */
+template<typename ArrayType>
+auto nd::concat(ArrayType array_to_concat)
 {
-    auto buffer = buffer_t<ValueType>(shape.volume());
-    return unique_provider_t<Rank, ValueType>(shape, std::move(buffer));
+    return concatenator_t<ArrayType>(0, std::move(array_to_concat));
 }
 
-template<typename ValueType, typename... Args>
-auto nd::make_unique_provider(Args... args)
+
+
+
+/**
+ * @brief      Return an operator that reads the elements of an array at the
+ *             given indexes. The result has the shape of the index array.
+ *
+ * @param      array_of_indexes  An array of index_t's of the operand's rank,
+ *                               or of row-major memory offsets (such as
+ *                               returned by where_offsets)
+ *
+ * @tparam     ArrayType         The type of the index array
+ *
+ * @return     The operator
+ *
+ * @note       If the operand is memory-backed, a row of the result is
+ *             evaluated by converting a block of indexes to memory offsets
+ *             and prefetching them before reading, so evaluating the result
+ *             (for example on a thread pool, with to_shared_parallel) is
+ *             bound by memory bandwidth rather than latency. The indexes are
+ *             not bounds-checked.
+ */
+template<typename ArrayType>
+auto nd::read_indexes(ArrayType array_of_indexes)
 {
-    return make_unique_provider<ValueType>(make_shape(args...));
+    return [array_of_indexes=std::move(array_of_indexes)] (auto&& array_to_index)
+    {
+        using source_type = std::decay_t<decltype(array_to_index)>;
+        auto mapping = detail::gather_mapping_t<ArrayType, source_type>(array_of_indexes, std::forward<decltype(array_to_index)>(array_to_index));
+        return make_array(std::move(mapping), array_of_indexes.shape());
+    };
 }
 
-template<typename Provider>
-auto nd::evaluate_as_unique(Provider&& source_provider)
+
+
+
+/**
+ * @brief      Return an operator that reads the elements of an array in the
+ *             order given by a gather plan (see make_gather_plan), into a new
+ *             memory-backed array of the plan's shape.
+ *
+ * @param[in]  plan        The gather plan; the operand must have its source
+ *                         shape
+ *
+ * @tparam     Rank        The rank of the result
+ * @tparam     SourceRank  The rank of the operand
+ *
+ * @return     The operator
+ *
+ * @note       The operand is read in ascending memory order, and the result
+ *             is written in the order of the plan. It is fastest for a
+ *             row-major or contiguous operand; other operands are read
+ *             element by element.
+ */
+template<std::size_t Rank, std::size_t SourceRank>
+auto nd::gather(gather_plan_t<Rank, SourceRank> plan)
 {
-    using value_type = typename std::remove_reference_t<Provider>::value_type;
-    auto target_shape = source_provider.shape();
-    auto target_accessor = make_access_pattern(target_shape);
-    auto target_provider = make_unique_provider<value_type>(target_shape);
+    return [plan] (auto&& array)
+    {
+        return detail::gather_planned(array, plan, 1, [] (std::size_t num_tasks, auto&& fn)
+        {
+            for (std::size_t n = 0; n < num_tasks; ++n) fn(n);
+        });
+    };
+}
+
+
+
 
-    for (auto index : target_accessor)
+/**
+ * @brief      As gather, but the elements are read by the workers of the
+ *             given pool, each reading a contiguous part of the plan.
+ *
+ * @param      pool        The thread pool to evaluate on; it must outlive the
+ *                         operator
+ * @param[in]  plan        The gather plan
+ *
+ * @tparam     Rank        The rank of the result
+ * @tparam     SourceRank  The rank of the operand
+ *
+ * @return     The operator
+ */
+template<std::size_t Rank, std::size_t SourceRank>
+auto nd::gather_parallel(thread_pool_t& pool, gather_plan_t<Rank, SourceRank> plan)
+{
+    return [&pool, plan] (auto&& array)
     {
-        target_provider(index) = source_provider(index);
-    }
-    return target_provider;
+        return detail::gather_planned(array, plan, 4 * (pool.size() + 1), [&pool] (std::size_t num_tasks, auto&& fn)
+        {
+            pool.parallel_for(num_tasks, fn);
+        });
+    };
+}
+
+
+
+
+/**
+ * @brief      Return an operator that selects a subset of an array.
+ *
+ * @param[in]  region_to_select  The region to select
+ *
+ * @tparam     Rank              Rank of the both the source and target arrays
+ *
+ * @return     The operator.
+ */
+template<std::size_t Rank>
+auto nd::select(access_pattern_t<Rank> region_to_select)
+{
+    return selector_t<Rank>(region_to_select);
+}
+
+auto nd::select_axis(std::size_t axis_to_select)
+{
+    return axis_selector_t(axis_to_select, 0, 0, false);
+}
+
+
+
+
+/**
+ * @brief      Replace a subset of an array with the contents of another.
+ *
+ * @param[in]  region_to_replace  The region to replace
+ * @param      replacement_array  The replacement array
+ *
+ * @tparam     Rank               Rank of both the array to patch and the
+ *                                replacement array
+ * @tparam     ArrayType          The type of the replacement array
+ *
+ * @return     A function returning arrays which map their indexes to the
+ *             replacement_array, if those indexes are in the region to replace
+ */
+template<std::size_t Rank, typename ArrayType>
+auto nd::replace(access_pattern_t<Rank> region_to_replace, ArrayType replacement_array)
+{
+    return replacer_t<Rank, ArrayType>(region_to_replace, std::move(replacement_array));
+}
+
+
+
+
+/**
+ * @brief      Return a select operator starting at the begin index.
+ *
+ * @param[in]  starting_index  The starting index
+ *
+ * @tparam     Rank            The rank of the array to operate on
+ *
+ * @return     The operator
+ */
+template<std::size_t Rank>
+auto nd::select_from(index_t<Rank> starting_index)
+{
+    return selector_t<Rank>().from(starting_index);
+}
+
+template<typename... Args>
+auto nd::select_from(Args... args)
+{
+    return select_from(make_index(args...));
+}
+
+
+
+
+/**
+ * @brief      Return a replace operator starting at the begin index.
+ *
+ * @param[in]  starting_index  The starting index
+ *
+ * @tparam     Rank            The rank of the array to operate on
+ *
+ * @return     The operator
+ */
+template<std::size_t Rank>
+auto nd::replace_from(index_t<Rank> starting_index)
+{
+    auto zeros = make_array(make_uniform_provider(0, make_uniform_shape<Rank>(1)));
+    return replacer_t<Rank, decltype(zeros)>({}, zeros).from(starting_index);
 }
 
-template<typename Provider>
-auto nd::evaluate_as_shared(Provider&& provider)
+template<typename... Args>
+auto nd::replace_from(Args... args)
 {
-    return evaluate_as_unique(std::forward<Provider>(provider)).shared();
+    return replace_from(make_index(args...));
 }
 
 
 
 
-//=============================================================================
-// Array factories
-//=============================================================================
-
-
-
-
 /**
- * @brief      Makes an array from the given provider.
+ * @brief      Reads an index from an array.
  *
- * @param      provider  The provider
+ * @param[in]  index_to_read  The index to read
  *
- * @tparam     Provider  The type of the provider
+ * @tparam     Rank           The rank of the array that can be read from
  *
- * @return     The array
+ * @return     The operator
  */
-template<typename Provider>
-auto nd::make_array(Provider&& provider)
+template<std::size_t Rank>
+auto nd::read_index(index_t<Rank> index_to_read)
 {
-    return array_t<Provider>(std::forward<Provider>(provider));
+    return [index_to_read] (auto&& array)
+    {
+        return array(index_to_read);
+    };
+}
+
+template<typename... Args>
+auto nd::read_index(Args... args)
+{
+    return read_index(make_index(args...));
 }
 
 
 
 
-template<typename Mapping, std::size_t Rank>
-auto nd::make_array(Mapping mapping, shape_t<Rank> shape)
+/**
+ * @brief      Return an operator that transforms the values of an array using
+ *             the given function object.
+ *
+ * @param      function  The function
+ *
+ * @tparam     Function  The type of the function object
+ *
+ * @return     The operator
+ */
+template<typename Function>
+auto nd::transform(Function function)
 {
-    return make_array(basic_provider_t<Mapping, Rank>(mapping, shape));
+    return [function] (auto&& array)
+    {
+        using array_type = std::decay_t<decltype(array)>;
+        auto shape = array.shape();
+        auto mapping = detail::transform_mapping_t<array_type, Function>(std::forward<decltype(array)>(array), function);
+        return make_array(std::move(mapping), shape);
+    };
 }
 
 
 
 
 /**
- * @brief      Makes a shared (immutable, copyable, memory-backed) array with
- *             the given shape, initialized to the default-constructed
- *             ValueType.
+ * @brief      Return a function that operates on two arrays, given a function
+ *             that operates on their value types.
  *
- * @param[in]  shape      The shape
+ * @param      function  The function
  *
- * @tparam     ValueType  The value type of the array
- * @tparam     Rank       The rank of the array
+ * @tparam     Function  The function type
  *
- * @return     The array
+ * @return     The operator
  */
-template<typename ValueType, std::size_t Rank>
-auto nd::make_shared_array(shape_t<Rank> shape)
+template<typename Function>
+auto nd::binary_op(Function function)
 {
-    return make_array(make_shared_provider<ValueType>(shape));
-}
+    return [function] (auto&& A, auto&& B)
+    {
+        using array_type_a = std::decay_t<decltype(A)>;
+        using array_type_b = std::decay_t<decltype(B)>;
 
-template<typename ValueType, typename... Args>
-auto nd::make_shared_array(Args... args)
-{
-    return make_array(make_shared_provider<ValueType>(args...));
+        if (A.shape() != B.shape())
+        {
+            throw std::logic_error("binary operation applied to arrays of different shapes");
+        }
+        auto shape = A.shape();
+        auto mapping = detail::binary_op_mapping_t<Function, array_type_a, array_type_b>(
+            function,
+            std::forward<decltype(A)>(A),
+            std::forward<decltype(B)>(B));
+        return make_array(std::move(mapping), shape);
+    };
 }
 
 
 
 
+
 /**
- * @brief      Makes a unique (mutable, non-copyable, memory-backed) array with
- *             the given shape.
+ * @brief      Mark a function object as being callable on SIMD packs as well as
+ *             on scalars, so that transform and binary_op may apply it to
+ *             several elements at once.
  *
- * @param[in]  shape      The shape
+ * @param      function  The function; it must return simd_pack_t<T, W> when
+ *                       called with simd_pack_t<T, W> arguments
  *
- * @tparam     ValueType  The value type of the array
- * @tparam     Rank       The rank of the array
+ * @tparam     Function  The function type
  *
- * @return     The array
+ * @return     A function object forwarding to the given function
+ *
+ * @example    B = A | transform(vectorized([] (auto x) { return x * x + 1.0; }));
+ *
+ * @note       Packs are only used for float and double arrays. The standard
+ *             arithmetic function objects (std::plus<> etc.) are treated as
+ *             vectorized already.
  */
-template<typename ValueType, std::size_t Rank>
-auto nd::make_unique_array(shape_t<Rank> shape)
+template<typename Function>
+auto nd::vectorized(Function function)
 {
-    return make_array(make_unique_provider<ValueType>(shape));
+    return detail::vectorized_t<Function>{function};
 }
 
-template<typename ValueType, typename... Args>
-auto nd::make_unique_array(Args... args)
+
+
+/**
+ * @brief      Returns an operator that caches its argument array: it is
+ *             evaluated to memory the first time any of its elements is read,
+ *             and every copy of the result (including those captured by other
+ *             operators) shares that memory.
+ *
+ * @return     The operator
+ *
+ * @note       Evaluation is thread-safe; concurrent readers wait for it to
+ *             finish.
+ */
+auto nd::cache()
 {
-    return make_array(make_unique_provider<ValueType>(args...));
+    return [] (auto&& array)
+    {
+        auto provider = array.get_provider();
+        auto tile_shape = array.shape();
+
+        for (std::size_t n = 0; n < rank(array); ++n)
+        {
+            tile_shape[n] = std::max(tile_shape[n], std::size_t(1));
+        }
+        return make_array(cached_provider_t<decltype(provider)>(std::move(provider), tile_shape));
+    };
 }
 
 
 
 
 /**
- * @brief      Returns an index-array of the given shape, mapping the index (i,
- *             j, ...) to itself.
- *
- * @param[in]  shape  The shape
+ * @brief      As cache, but the argument array is evaluated one tile at a
+ *             time, as elements of each tile are first read.
  *
- * @tparam     Rank   The rank of the array
+ * @param      tile_shape  The shape of the tiles
  *
- * @return     The array
+ * @return     The operator
  */
 template<std::size_t Rank>
-auto nd::index_array(shape_t<Rank> shape)
+auto nd::cache(shape_t<Rank> tile_shape)
 {
-    auto mapping = [shape] (auto&& index) { return index; };
-    return make_array(basic_provider_t<decltype(mapping), Rank>(mapping, shape));
+    return [tile_shape] (auto&& array)
+    {
+        auto provider = array.get_provider();
+        return make_array(cached_provider_t<decltype(provider)>(std::move(provider), tile_shape));
+    };
 }
 
-template<typename... Args>
-auto nd::index_array(Args... args)
+
+
+
+/**
+ * @brief      Returns an operator that evaluates its argument array to a
+ *             block-sparse array: one holding dense memory only for the tiles
+ *             containing a value other than the background.
+ *
+ * @param      tile_shape  The shape of the tiles
+ * @param      background  The value that tiles are compared against; it is
+ *                         converted to the array's value type
+ *
+ * @return     The operator
+ *
+ * @note       The array is evaluated once, one tile at a time, so the
+ *             memory in use is that of the dense tiles and one more. Sums of
+ *             arithmetic block-sparse arrays add background tiles without
+ *             visiting their elements.
+ */
+template<std::size_t Rank, typename ValueType>
+auto nd::to_block_sparse(shape_t<Rank> tile_shape, ValueType background)
 {
-    return index_array(make_shape(args...));
+    return [tile_shape, background] (auto&& array)
+    {
+        using value_type = std::decay_t<value_type_of<decltype(array)>>;
+
+        return make_array(detail::make_block_sparse(array.get_provider(), tile_shape, value_type(background), [] (std::size_t num_tasks, auto&& fn)
+        {
+            for (std::size_t n = 0; n < num_tasks; ++n) fn(n);
+        }));
+    };
 }
 
 
 
 
 /**
- * @brief      Zip a sequence identically-shaped arrays together
- *
- * @param      arrays      The arrays
+ * @brief      As to_block_sparse, but the tiles are evaluated on a thread
+ *             pool.
  *
- * @tparam     ArrayTypes  The types of the arrays
+ * @param      pool        The thread pool to evaluate on; it must outlive the
+ *                         operator
+ * @param      tile_shape  The shape of the tiles
+ * @param      background  The background value
  *
- * @return     An array which returns tuples taken from the underlying arrays
+ * @return     The operator
  */
-template<typename... ArrayTypes>
-auto nd::zip_arrays(ArrayTypes... arrays)
+template<std::size_t Rank, typename ValueType>
+auto nd::to_block_sparse_parallel(thread_pool_t& pool, shape_t<Rank> tile_shape, ValueType background)
 {
-    constexpr std::size_t Ranks[] = {ArrayTypes::rank...};
-    shape_t<Ranks[0]> shapes[] = {arrays.shape()...};
-
-    if (std::adjacent_find(std::begin(shapes), std::end(shapes), std::not_equal_to<>()) != std::end(shapes))
-    {
-        throw std::logic_error("cannot zip arrays with different shapes");
-    }
-    auto mapping = [arrays...] (auto&& index)
+    return [&pool, tile_shape, background] (auto&& array)
     {
-        return std::make_tuple(arrays(index)...);
+        using value_type = std::decay_t<value_type_of<decltype(array)>>;
+
+        return make_array(detail::make_block_sparse(array.get_provider(), tile_shape, value_type(background), [&pool] (std::size_t num_tasks, auto&& fn)
+        {
+            pool.parallel_for(num_tasks, fn);
+        }));
     };
-    return make_array(mapping, shapes[0]);
 }
 
 
 
 
 /**
- * @brief      Return an array that is the cartesian product of the argument
- *             arrays, A(i, j, k) == make_tuple(a(i), b(j), c(k))
- *
- * @param[in]  arrays      A sequence of 1d arrays
+ * @brief      Returns an operator that evaluates a tuple-valued array (such
+ *             as one made by zip_arrays or cartesian_product) to
+ *             struct-of-arrays memory: one shared buffer per component of the
+ *             tuple.
  *
- * @tparam     ArrayTypes  The types of the argument arrays
+ * @return     The operator
  *
- * @return     The array
+ * @note       Use unzip to get each component of the result as a
+ *             memory-backed array, without copying.
  */
-template<typename... ArrayTypes>
-auto nd::cartesian_product(ArrayTypes... arrays)
+auto nd::to_shared_soa()
 {
-    shape_t<sizeof...(ArrayTypes)> shape = {arrays.size()...};
-
-    auto mapping = [arrays...] (auto&& index)
+    return [] (auto&& array)
     {
-        return detail::zip_apply_tuple(std::forward_as_tuple(arrays...), index.as_tuple());
+        using value_type = std::decay_t<value_type_of<decltype(array)>>;
+        auto regions = std::vector<decltype(array.indexes())>{array.indexes()};
+
+        return make_array(detail::make_soa(array.get_provider(), regions, [] (std::size_t num_tasks, auto&& fn)
+        {
+            for (std::size_t n = 0; n < num_tasks; ++n) fn(n);
+        }, std::make_index_sequence<std::tuple_size<value_type>::value>()));
     };
-    return make_array(mapping, shape);
 }
 
 
 
 
 /**
- * @brief      Return an array of zeros with the given shape
- *
- * @param[in]  args       shape arguments
+ * @brief      As to_shared_soa, but the array is evaluated on a thread pool.
  *
- * @tparam     ValueType  Defaults to int; use e.g. zeros<double>(...) for other
- *                        types
- * @tparam     Args       Argument types (should be a positive integral type)
+ * @param      pool  The thread pool to evaluate on; it must outlive the
+ *                   operator
  *
- * @return     An array of zeros, only requiring storage for a single element.
+ * @return     The operator
  */
-template<typename ValueType, typename... Args>
-auto nd::zeros(Args... args)
+auto nd::to_shared_soa_parallel(thread_pool_t& pool)
 {
-    return make_array(nd::make_uniform_provider(ValueType(0), args...));
+    return [&pool] (auto&& array)
+    {
+        using value_type = std::decay_t<value_type_of<decltype(array)>>;
+
+        return make_array(detail::make_soa(array.get_provider(), detail::tiles_for_pool(array.shape(), pool), [&pool] (std::size_t num_tasks, auto&& fn)
+        {
+            pool.parallel_for(num_tasks, fn);
+        }, std::make_index_sequence<std::tuple_size<value_type>::value>()));
+    };
 }
 
 
 
 
 /**
- * @brief      Return an array of ones with the given shape
+ * @brief      Returns an operator that splits a tuple-valued array into a
+ *             std::tuple of arrays, one per component.
  *
- * @param[in]  args       shape arguments
+ * @return     The operator
  *
- * @tparam     ValueType  Defaults to int; use e.g. ones<double>(...) for other
- *                        types
- * @tparam     Args       Argument types (should be a positive integral type)
+ * @note       The components of a struct-of-arrays array (see to_shared_soa)
+ *             are shared arrays viewing its memory; those of other arrays
+ *             are lazy, each reading its component from the original.
  *
- * @return     An array of ones, only requiring storage for a single element.
+ * @example    auto [x, y] = zip_arrays(A, B) | to_shared_soa() | unzip();
  */
-template<typename ValueType, typename... Args>
-auto nd::ones(Args... args)
+auto nd::unzip()
 {
-    return make_array(nd::make_uniform_provider(ValueType(1), args...));
+    return [] (auto&& array)
+    {
+        using value_type = std::decay_t<value_type_of<decltype(array)>>;
+        return detail::unzip_components(array, std::make_index_sequence<std::tuple_size<value_type>::value>());
+    };
 }
 
 
 
-
 /**
- * @brief      Try to promote the argument to an array of the given shape
+ * @brief      Returns an operator that applies a stencil to an array: each
+ *             element of the result is a weighted sum of a neighbourhood of
+ *             elements of its argument.
  *
- * @param      arg    The argument
- * @param[in]  shape  The shape
+ * @param      kernel     An array of weights, of the same rank as the arrays
+ *                        the operator is applied to
  *
- * @tparam     Arg    The argument type
- * @tparam     Rank   The rank of the shape to promote the argument to
+ * @tparam     ArrayType  The type of the kernel array
  *
- * @return     An array with the given shape
+ * @return     The operator
+ *
+ * @note       The result R of applying the stencil to A is smaller than A by
+ *             kernel.shape(n) - 1 on each axis n, and R(i) = sum over k of
+ *             kernel(k) * A(i + k). A kernel of extent 2r + 1 centered on each
+ *             point thus drops r elements from each end of every axis, and a
+ *             kernel of extent 2 on one axis gives the shape of a shift_by(1)
+ *             along that axis. Zero weights are skipped, so a 7-point
+ *             Laplacian may be written as a 3x3x3 kernel.
  */
-template<typename Arg, std::size_t Rank>
-auto nd::promote(Arg arg, nd::shape_t<Rank> shape)
+template<typename ArrayType>
+auto nd::stencil(ArrayType kernel)
 {
-    if constexpr (std::is_arithmetic<Arg>::value)
+    constexpr std::size_t R = ArrayType::rank;
+    using weight_type = std::decay_t<value_type_of<ArrayType>>;
+    using group_type = detail::stencil_tap_group_t<R, weight_type>;
+
+    if (kernel.size() == 0)
     {
-        return make_array(make_uniform_provider(arg, shape));
+        throw std::logic_error("stencil kernel must not be empty");
     }
-    else
+    auto groups = std::vector<group_type>();
+
+    for (const auto& index : kernel.indexes())
     {
-        return arg;
+        auto w = weight_type(kernel(index));
+
+        if (w != weight_type())
+        {
+            auto offset = index;
+            offset[R - 1] = 0;
+
+            if (groups.empty() || groups.back().offset != offset)
+            {
+                groups.push_back({offset, {}});
+            }
+            groups.back().taps.emplace_back(index[R - 1], w);
+        }
     }
+    auto kernel_shape = kernel.shape();
+
+    return [groups, kernel_shape] (auto array)
+    {
+        static_assert(decltype(array)::rank == R, "stencil kernel and array must have the same rank");
+
+        auto shape = array.shape();
+
+        for (std::size_t n = 0; n < R; ++n)
+        {
+            if (shape[n] < kernel_shape[n])
+            {
+                throw std::logic_error("stencil kernel is larger than the array it is applied to");
+            }
+            shape[n] -= kernel_shape[n] - 1;
+        }
+        auto mapping = detail::stencil_mapping_t<decltype(array), weight_type>(std::move(array), groups, kernel_shape[R - 1]);
+        return make_array(std::move(mapping), shape);
+    };
 }
 
 
 
 
 //=============================================================================
-// Operator factories
+// More array factories, which must be defined after the operator factories
 //=============================================================================
 
 
 
 
 /**
- * @brief      Return an operator that attempts to reshape its argument array to
- *             the given shape.
+ * @brief      Return a 1d array of containing the indexes where the given array
+ *             evaluates to true
  *
- * @param[in]  new_shape  The new shape
+ * @param      array      The array
  *
- * @tparam     Rank       The rank of the argument array
+ * @tparam     ArrayType  The type of the argument array
  *
- * @return     The operator
+ * @return     An immutable, memory-backed 1d array of index_t<rank>, where rank
+ *             is the rank of the argument array
+ *
+ * @note       Each element of the argument is evaluated exactly once.
  */
-template<std::size_t Rank>
-auto nd::reshape(shape_t<Rank> new_shape)
+template<typename ArrayType>
+auto nd::where(ArrayType array)
 {
-    return [new_shape] (auto&& array)
-    {
-        const auto& provider = array.get_provider();
-
-        if (new_shape.volume() != provider.size())
-        {
-            throw std::logic_error("cannot reshape array to a different size");
-        }
-        return make_array(provider.reshape(new_shape));
-    };
-}
+    auto regions = std::vector<access_pattern_t<rank(array)>>();
 
-template<typename... Args>
-auto nd::reshape(Args... args)
-{
-    return reshape(make_shape(args...));
+    if (array.size() > 0)
+    {
+        regions.push_back(array.indexes());
+    }
+    return detail::find_indexes<false>(array, regions, [] (std::size_t num_tasks, auto&& fn)
+    {
+        for (std::size_t n = 0; n < num_tasks; ++n) fn(n);
+    });
 }
 
 
 
 
 /**
- * @brief      Returns an operator that, applied to any array will yield a
- *             shared, memory-backed version of that array.
+ * @brief      As where, but the condition is evaluated in parallel by the
+ *             workers of the given pool; the indexes are in the same order.
  *
- * @return     The operator.
+ * @param[in]  array      The array whose elements are tested
+ * @param      pool       The thread pool to evaluate on
+ *
+ * @tparam     ArrayType  The type of the array
+ *
+ * @return     An immutable, memory-backed 1d array of index_t<rank>
  */
-auto nd::to_shared()
+template<typename ArrayType>
+auto nd::where(ArrayType array, thread_pool_t& pool)
 {
-    return [] (auto&& array)
+    return detail::find_indexes<false>(array, detail::partition_for_pool(array.shape(), pool), [&pool] (std::size_t num_tasks, auto&& fn)
     {
-        return make_array(evaluate_as_unique(array.get_provider()));
-    };
+        pool.parallel_for(num_tasks, fn);
+    });
 }
 
 
 
 
 /**
- * @brief      Returns an operator that, applied to any array will yield a
- *             unique, memory-backed version of that array.
+ * @brief      Return a 1d array containing the row-major memory offsets of the
+ *             elements where the given array evaluates to true. This takes
+ *             1/rank the memory of the index_t array returned by where.
  *
- * @return     The operator.
+ * @param[in]  array      The array whose elements are tested
+ *
+ * @tparam     ArrayType  The type of the array
+ *
+ * @return     An immutable, memory-backed 1d array of std::size_t
  */
-auto nd::to_unique()
+template<typename ArrayType>
+auto nd::where_offsets(ArrayType array)
 {
-    return [] (auto&& array)
+    auto regions = std::vector<access_pattern_t<rank(array)>>();
+
+    if (array.size() > 0)
     {
-        return make_array(evaluate_as_shared(array.get_provider()));
-    };
+        regions.push_back(array.indexes());
+    }
+    return detail::find_indexes<true>(array, regions, [] (std::size_t num_tasks, auto&& fn)
+    {
+        for (std::size_t n = 0; n < num_tasks; ++n) fn(n);
+    });
 }
 
 
 
 
 /**
- * @brief      Return an operator that turns an array into a bounds-checking
- *             array.
+ * @brief      As where_offsets, evaluated in parallel by the workers of the
+ *             given pool.
  *
- * @return     The array
+ * @param[in]  array      The array whose elements are tested
+ * @param      pool       The thread pool to evaluate on
+ *
+ * @tparam     ArrayType  The type of the array
+ *
+ * @return     An immutable, memory-backed 1d array of std::size_t
  */
-auto nd::bounds_check()
+template<typename ArrayType>
+auto nd::where_offsets(ArrayType array, thread_pool_t& pool)
 {
-    return [] (auto&& array)
+    return detail::find_indexes<true>(array, detail::partition_for_pool(array.shape(), pool), [&pool] (std::size_t num_tasks, auto&& fn)
     {
-        auto mapping = [array] (auto&& index)
-        {
-            if (! array.shape().contains(index))
-            {
-                throw std::out_of_range("index out-of-range");
-            }
-            return array(index);
-        };
-        return make_array(mapping, array.shape());
-    };
+        pool.parallel_for(num_tasks, fn);
+    });
 }
 
 
 
 
 /**
- * @brief      Return an operator that sums the elements of an array.
+ * @brief      Make a plan for reading the elements of arrays of the given
+ *             shape at the given indexes, for use with the gather operator.
+ *             The indexes are converted to memory offsets once, and sorted
+ *             into buckets of nearby offsets, remembering where each one
+ *             goes in the result. Making a plan costs about as much as one
+ *             gather with read_indexes; it pays off when the same indexes
+ *             are read from several arrays, or from one array repeatedly.
  *
- * @return     The operator
+ * @param      array_of_indexes  An array of index_t<SourceRank>, or of
+ *                               row-major memory offsets
+ * @param[in]  source_shape      The shape of the arrays to be read
  *
- * @note       The return type is the same as the array value type, except if
- *             it's bool - in which case the return type is unsigned long.
+ * @tparam     SourceRank        The rank of the arrays to be read
+ * @tparam     ArrayType         The type of the index array
+ *
+ * @return     A gather plan, whose shape is that of the index array
+ *
+ * @note       Throws a logic_error if any index is outside the source shape.
  */
-auto nd::sum()
+template<std::size_t SourceRank, typename ArrayType>
+auto nd::make_gather_plan(ArrayType array_of_indexes, shape_t<SourceRank> source_shape)
 {
-    return [] (auto&& array)
-    {
-        using value_type = nd::value_type_of<decltype(array)>;
-        using is_boolean = std::is_same<value_type, bool>;
-        using result_type = std::conditional_t<is_boolean::value, unsigned long, value_type>;
+    using index_type = std::decay_t<value_type_of<ArrayType>>;
+
+    static_assert(std::is_integral<index_type>::value || std::is_same<index_type, index_t<SourceRank>>::value,
+        "make_gather_plan needs an array of index_t's of the source rank, or of row-major memory offsets");
+
+    auto strides = make_strides_row_major(source_shape);
+    auto volume = source_shape.volume();
+    auto count = array_of_indexes.size();
+    auto offsets = buffer_t<std::size_t>(count, uninitialized);
+    auto n = std::size_t(0);
 
-        auto result = result_type();
+    for (const auto& index : array_of_indexes.indexes())
+    {
+        auto i = array_of_indexes(index);
 
-        for (const auto& i : array.indexes())
+        if constexpr (std::is_integral<index_type>::value)
         {
-            result += array(i);
+            if constexpr (std::is_signed<index_type>::value)
+            {
+                if (i < 0)
+                {
+                    throw std::logic_error("gather offset is outside the source shape");
+                }
+            }
+            if (std::size_t(i) >= volume)
+            {
+                throw std::logic_error("gather offset is outside the source shape");
+            }
+            offsets[n++] = std::size_t(i);
         }
-        return result;
-    };
-}
+        else
+        {
+            if (! source_shape.contains(i))
+            {
+                throw std::logic_error("gather index is outside the source shape");
+            }
+            offsets[n++] = strides.compute_offset(i);
+        }
+    }
 
+    // A counting sort on the offsets divided by a bucket width: at least 512
+    // elements (a few pages), and wide enough that there are no more buckets
+    // than indexes. It is stable, so positions within a bucket stay in order.
+    auto shift = std::size_t(9);
 
+    while ((volume >> shift) > std::max(count, std::size_t(1)))
+    {
+        ++shift;
+    }
+    auto starts = std::vector<std::size_t>((volume >> shift) + 2);
 
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        ++starts[(offsets[k] >> shift) + 1];
+    }
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
 
-/**
- * @brief      Return a reduce operator that returns true if all of its
- *             argument array's elements evaluate to true.
- *
- * @return     The operator
- */
-auto nd::all()
-{
-    return [] (auto&& array)
+    auto sorted_offsets = buffer_t<std::size_t>(count, uninitialized);
+    auto positions = buffer_t<std::size_t>(count, uninitialized);
+
+    for (std::size_t k = 0; k < count; ++k)
     {
-        for (const auto& i : array.indexes()) if (! array(i)) return false;
-        return true;
-    };
+        auto m = starts[offsets[k] >> shift]++;
+        sorted_offsets[m] = offsets[k];
+        positions[m] = k;
+    }
+    return gather_plan_t<ArrayType::rank, SourceRank>(array_of_indexes.shape(), source_shape, std::move(sorted_offsets), std::move(positions));
 }
 
 
 
 
 /**
- * @brief      Return a reduce operator that returns true if any of its
- *             argument array's elements evaluate to true.
+ * @brief      Read an array from a file in the numpy .npy format.
  *
- * @return     The operator
+ * @param[in]  filename   The file name
+ *
+ * @tparam     ValueType  The value type stored in the file
+ * @tparam     Rank       The rank of the array stored in the file
+ *
+ * @return     An immutable, memory-backed array; its buffer is read from the
+ *             file in a single call
+ *
+ * @note       Throws std::runtime_error if the file cannot be read, or if its
+ *             value type, rank, or memory order do not match.
  */
-auto nd::any()
+template<typename ValueType, std::size_t Rank>
+auto nd::load_npy(const std::string& filename)
 {
-    return [] (auto&& array)
+    auto stream = std::ifstream(filename, std::ios::binary);
+
+    if (! stream)
     {
-        for (const auto& i : array.indexes()) if (array(i)) return true;
-        return false;
-    };
+        throw std::runtime_error("could not open " + filename);
+    }
+    auto header = detail::read_npy_header(stream);
+    auto shape = detail::validate_npy_header<ValueType, Rank>(header);
+    auto buffer = std::make_shared<buffer_t<ValueType>>(shape.volume(), uninitialized);
+
+    if (! stream.read(reinterpret_cast<char*>(buffer->data()), buffer->size() * sizeof(ValueType)))
+    {
+        throw std::runtime_error("unexpected end of file in " + filename);
+    }
+    return make_array(shared_provider_t<Rank, ValueType>(shape, buffer));
 }
 
 
 
 
 /**
- * @brief      Return an operator that shifts an array along an axis
+ * @brief      Return a read-only array backed by a memory-mapped .npy file,
+ *             without copying its contents.
  *
- * @param[in]  delta  The amount to shift by
+ * @param[in]  filename   The file name
  *
- * @return     The operator
- * 
- * @example    B = A | shift_by(-2).along_axis(1); // B(i, j) == A(i, j + 2)
+ * @tparam     ValueType  The value type stored in the file
+ * @tparam     Rank       The rank of the array stored in the file
+ *
+ * @return     An immutable, memory-backed array; the file stays mapped for as
+ *             long as any copy of the array exists
+ *
+ * @note       Throws std::runtime_error if the file cannot be mapped, or if
+ *             its value type, rank, or memory order do not match.
  */
-auto nd::shift_by(int delta)
+template<typename ValueType, std::size_t Rank>
+auto nd::map_npy(const std::string& filename)
 {
-    return shifter_t(0, delta);
+    auto stream = std::ifstream(filename, std::ios::binary);
+
+    if (! stream)
+    {
+        throw std::runtime_error("could not open " + filename);
+    }
+    auto header = detail::read_npy_header(stream);
+    auto shape = detail::validate_npy_header<ValueType, Rank>(header);
+    auto file = std::make_shared<const detail::mapped_file_t>(filename);
+    return make_array(mmap_provider_t<Rank, ValueType>(shape, file, header.data_offset));
 }
 
 
 
 
 /**
- * @brief      Return an operator that freezes one index its argument array,
- *             reducing its rank by 1.
+ * @brief      Write an array to a file in the numpy .npy format.
  *
- * @param[in]  axis_to_freeze  The axis to freeze
+ * @param[in]  filename   The file name
+ * @param[in]  array      The array to write; memory-backed arrays are written
+ *                        straight from their buffer, and other arrays are
+ *                        evaluated and written one row at a time
  *
- * @return     The operator
+ * @tparam     ArrayType  The type of the array
  */
-auto nd::freeze_axis(std::size_t axis_to_freeze)
+template<typename ArrayType>
+void nd::save_npy(const std::string& filename, const ArrayType& array)
 {
-    return axis_freezer_t<1>(make_index(axis_to_freeze));
+    using value_type = std::decay_t<value_type_of<ArrayType>>;
+    using provider_type = typename ArrayType::provider_type;
+
+    auto stream = std::ofstream(filename, std::ios::binary);
+
+    if (! stream)
+    {
+        throw std::runtime_error("could not open " + filename);
+    }
+    stream << detail::make_npy_header(detail::npy_descr<value_type>(), array.shape());
+
+    const value_type* contiguous_data = nullptr;
+
+    if constexpr (detail::is_row_major_memory_provider<provider_type>::value)
+    {
+        contiguous_data = array.data();
+    }
+    else if constexpr (detail::is_strided_memory_provider<provider_type>::value)
+    {
+        if (array.get_provider().contiguous())
+        {
+            contiguous_data = array.data();
+        }
+    }
+
+    if (contiguous_data)
+    {
+        stream.write(reinterpret_cast<const char*>(contiguous_data), array.size() * sizeof(value_type));
+    }
+    else
+    {
+        auto row = buffer_t<value_type>(array.shape(rank(array) - 1));
+
+        detail::for_each_row(array.indexes(), [&] (const auto& index, std::size_t count)
+        {
+            detail::evaluate_row(array.get_provider(), index, row.data(), count);
+            stream.write(reinterpret_cast<const char*>(row.data()), count * sizeof(value_type));
+        });
+    }
+    if (! stream)
+    {
+        throw std::runtime_error("could not write " + filename);
+    }
 }
 
 
 
 
+//=============================================================================
+// The array class itself
+//=============================================================================
+
+
+
+
 /**
- * @brief      Return a reducer operator, which can apply the given operator
- *             along a given axis
- *
- * @param      reduction     The reduction
- *
- * @tparam     OperatorType  The type of function object to be applied along an
- *                           axis
+ * @brief      The actual array class template
  *
- * @return     The operator
+ * @tparam     Rank      The array dimensionality
+ * @tparam     Provider  Type defining the index space and mapping from indexes
+ *                       to values
  */
-template<typename OperatorType>
-auto nd::collect(OperatorType reduction)
+template<typename Provider>
+class nd::array_t
 {
-    return axis_reducer_t<OperatorType>(0, std::forward<OperatorType>(reduction));
-}
+public:
+
+    using provider_type = Provider;
+    using value_type = typename Provider::value_type;
+    static constexpr std::size_t rank = Provider::rank;
 
+    //=========================================================================
+    array_t() = default;
+    constexpr array_t(Provider&& provider) : provider(std::move(provider)) {}
 
+    // indexing functions
+    //=========================================================================
+    template<typename... Args> constexpr decltype(auto) operator()(Args... args) const { return provider(make_index(args...)); }
+    template<typename... Args> constexpr decltype(auto) operator()(Args... args)       { return provider(make_index(args...)); }
+    constexpr decltype(auto) operator()(const index_t<rank>& index) const { return provider(index); }
+    constexpr decltype(auto) operator()(const index_t<rank>& index)       { return provider(index); }
+    constexpr decltype(auto) data() const { return provider.data(); }
+    constexpr decltype(auto) data()       { return provider.data(); }
 
+    // query functions and operator support
+    //=========================================================================
+    constexpr auto shape() const { return provider.shape(); }
+    constexpr auto shape(std::size_t axis) const { return provider.shape()[axis]; }
+    constexpr auto size() const { return provider.size(); }
+    const Provider& get_provider() const { return provider; }
+    auto indexes() const { return make_access_pattern(provider.shape()); }
+    template<typename Function> auto operator|(Function&& fn) const & { return std::forward<Function>(fn)(*this); }
+    template<typename Function> auto operator|(Function&& fn)      && { return std::forward<Function>(fn)(std::move(*this)); }
 
-/**
- * @brief      Return an operator that concats the given array onto another.
- *
- * @param      array_to_concat  The array to concatenate
- *
- * @tparam     ArrayType        The type of the array to concatenate
- *
- * @return     The operator
- *
- * @note       The returned operator will fail to compile if applied to arrays
- *             of a different rank than the array to concatenate. It will throw
- *             a logic_error if the array shapes are incompatible.
- */
-template<typename ArrayType>
-auto nd::concat(ArrayType array_to_concat)
+    // methods converting this to a memory-backed array
+    //=========================================================================
+    auto unique() const { return make_array(evaluate_as_unique(provider)); }
+    auto shared() const & { return make_array(evaluate_as_shared(provider)); }
+    auto shared()      &&
+    {
+        if constexpr (detail::is_unique_provider<Provider>::value)
+        {
+            return make_array(std::move(provider).shared());
+        }
+        else
+        {
+            return make_array(evaluate_as_shared(provider));
+        }
+    }
+
+    // arithmetic operators
+    //=========================================================================
+    template<typename T> auto operator+(T&& A) const &  { return bin_op(*this, std::forward<T>(A), std::plus<>()); }
+    template<typename T> auto operator+(T&& A)      &&  { return bin_op(std::move(*this), std::forward<T>(A), std::plus<>()); }
+    template<typename T> auto operator-(T&& A) const &  { return bin_op(*this, std::forward<T>(A), std::minus<>()); }
+    template<typename T> auto operator-(T&& A)      &&  { return bin_op(std::move(*this), std::forward<T>(A), std::minus<>()); }
+    template<typename T> auto operator*(T&& A) const &  { return bin_op(*this, std::forward<T>(A), std::multiplies<>()); }
+    template<typename T> auto operator*(T&& A)      &&  { return bin_op(std::move(*this), std::forward<T>(A), std::multiplies<>()); }
+    template<typename T> auto operator/(T&& A) const &  { return bin_op(*this, std::forward<T>(A), std::divides<>()); }
+    template<typename T> auto operator/(T&& A)      &&  { return bin_op(std::move(*this), std::forward<T>(A), std::divides<>()); }
+    template<typename T> auto operator&&(T&& A) const & { return bin_op(*this, std::forward<T>(A), std::logical_and<>()); }
+    template<typename T> auto operator&&(T&& A)      && { return bin_op(std::move(*this), std::forward<T>(A), std::logical_and<>()); }
+    template<typename T> auto operator||(T&& A) const & { return bin_op(*this, std::forward<T>(A), std::logical_or<>()); }
+    template<typename T> auto operator||(T&& A)      && { return bin_op(std::move(*this), std::forward<T>(A), std::logical_or<>()); }
+    template<typename T> auto operator==(T&& A) const & { return bin_op(*this, std::forward<T>(A), std::equal_to<>()); }
+    template<typename T> auto operator==(T&& A)      && { return bin_op(std::move(*this), std::forward<T>(A), std::equal_to<>()); }
+    template<typename T> auto operator!=(T&& A) const & { return bin_op(*this, std::forward<T>(A), std::not_equal_to<>()); }
+    template<typename T> auto operator!=(T&& A)      && { return bin_op(std::move(*this), std::forward<T>(A), std::not_equal_to<>()); }
+    template<typename T> auto operator<=(T&& A) const & { return bin_op(*this, std::forward<T>(A), std::less_equal<>()); }
+    template<typename T> auto operator<=(T&& A)      && { return bin_op(std::move(*this), std::forward<T>(A), std::less_equal<>()); }
+    template<typename T> auto operator>=(T&& A) const & { return bin_op(*this, std::forward<T>(A), std::greater_equal<>()); }
+    template<typename T> auto operator>=(T&& A)      && { return bin_op(std::move(*this), std::forward<T>(A), std::greater_equal<>()); }
+    template<typename T> auto operator<(T&& A) const &  { return bin_op(*this, std::forward<T>(A), std::less<>()); }
+    template<typename T> auto operator<(T&& A)      &&  { return bin_op(std::move(*this), std::forward<T>(A), std::less<>()); }
+    template<typename T> auto operator>(T&& A) const &  { return bin_op(*this, std::forward<T>(A), std::greater<>()); }
+    template<typename T> auto operator>(T&& A)      &&  { return bin_op(std::move(*this), std::forward<T>(A), std::greater<>()); }
+    template<typename T> auto operator-() const { return transform(std::negate<>()); }
+    template<typename T> auto operator!() const { return transform(std::logical_not<>()); }
+
+private:
+    //=========================================================================
+    template<typename Self, typename OtherType, typename Function>
+    static auto bin_op(Self&& self, OtherType&& other, Function&& function)
+    {
+        auto F = binary_op(std::forward<Function>(function));
+        auto B = promote(std::forward<OtherType>(other), self.shape());
+        return F(std::forward<Self>(self), std::move(B));
+    }
+    Provider provider;
+};
+
+
+
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+
+
+
+template<typename Function, typename Tuple, std::size_t... Is>
+auto nd::detail::transform_tuple_impl(Function&& fn, const Tuple& t, std::index_sequence<Is...>)
+{
+    return std::make_tuple(fn(std::get<Is>(t))...);
+}
+
+template<typename Function, typename Tuple>
+auto nd::detail::transform_tuple(Function&& fn, const Tuple& t)
 {
-    return concatenator_t<ArrayType>(0, std::forward<ArrayType>(array_to_concat));
+    return transform_tuple_impl(std::forward<Function>(fn), t, std::make_index_sequence<std::tuple_size<Tuple>::value>());
 }
 
+template<typename FunctionTuple, typename ArgumentTuple, std::size_t... Is>
+auto nd::detail::zip_apply_tuple_impl(FunctionTuple&& fn, ArgumentTuple&& args, std::index_sequence<Is...>)
+{
+    return std::make_tuple(std::get<Is>(fn)(std::get<Is>(args))...);
+}
 
+template<typename FunctionTuple, typename ArgumentTuple>
+auto nd::detail::zip_apply_tuple(FunctionTuple&& fn, ArgumentTuple&& args)
+{
+    return zip_apply_tuple_impl(
+        std::forward<FunctionTuple>(fn),
+        std::forward<ArgumentTuple>(args),
+        std::make_index_sequence<std::tuple_size<ArgumentTuple>::value>());
+}
 
-
-template<typename ArrayType>
-auto nd::read_indexes(ArrayType array_of_indexes)
+template<typename ResultSequence, typename SourceSequence, typename IndexContainer>
+auto nd::detail::read_elements(const SourceSequence& source, IndexContainer indexes)
 {
-    return [array_of_indexes] (auto array_to_index)
+    auto target_n = std::size_t(0);
+    auto result = ResultSequence();
+
+    for (std::size_t n = 0; n < source.size(); ++n)
     {
-        auto mapping = [array_of_indexes, array_to_index] (auto&& index)
+        if (std::find(std::begin(indexes), std::end(indexes), n) != std::end(indexes))
         {
-            return array_to_index(array_of_indexes(index));
-        };
-        return make_array(mapping, array_of_indexes.shape());
-    };
+            result[target_n++] = source[n];
+        }
+    }
+    return result;
 }
 
+template<typename ResultSequence, typename SourceSequence, typename IndexContainer, typename Sequence>
+auto nd::detail::insert_elements(const SourceSequence& source, IndexContainer indexes, Sequence values)
+{
+    static_assert(indexes.size() == values.size());
 
+    auto source1_n = std::size_t(0);
+    auto source2_n = std::size_t(0);
+    auto result = ResultSequence();
 
+    for (std::size_t n = 0; n < result.size(); ++n)
+    {
+        if (std::find(std::begin(indexes), std::end(indexes), n) == std::end(indexes))
+        {
+            result[n] = source[source1_n++];
+        }
+        else
+        {
+            result[n] = values[source2_n++];
+        }
+    }
+    return result;
+}
 
-/**
- * @brief      Return an operator that selects a subset of an array.
- *
- * @param[in]  region_to_select  The region to select
- *
- * @tparam     Rank              Rank of the both the source and target arrays
- *
- * @return     The operator.
- */
-template<std::size_t Rank>
-auto nd::select(access_pattern_t<Rank> region_to_select)
+template<typename ResultSequence, typename SourceSequence, typename IndexContainer>
+auto nd::detail::remove_elements(const SourceSequence& source, IndexContainer indexes)
 {
-    return selector_t<Rank>(region_to_select);
+    auto target_n = std::size_t(0);
+    auto result = ResultSequence();
+
+    for (std::size_t n = 0; n < source.size(); ++n)
+    {
+        if (std::find(std::begin(indexes), std::end(indexes), n) == std::end(indexes))
+        {
+            result[target_n++] = source[n];
+        }
+    }
+    return result;
 }
 
-auto nd::select_axis(std::size_t axis_to_select)
+template<typename SequenceA, typename SequenceB, std::size_t... Is>
+std::size_t nd::detail::inner_product(const SequenceA& a, const SequenceB& b, std::index_sequence<Is...>)
 {
-    return axis_selector_t(axis_to_select, 0, 0, false);
+    return (std::size_t(0) + ... + (a[Is] * b[Is]));
 }
 
-
-
-
-/**
- * @brief      Replace a subset of an array with the contents of another.
- *
- * @param[in]  region_to_replace  The region to replace
- * @param      replacement_array  The replacement array
- *
- * @tparam     Rank               Rank of both the array to patch and the
- *                                replacement array
- * @tparam     ArrayType          The type of the replacement array
- *
- * @return     A function returning arrays which map their indexes to the
- *             replacement_array, if those indexes are in the region to replace
- */
-template<std::size_t Rank, typename ArrayType>
-auto nd::replace(access_pattern_t<Rank> region_to_replace, ArrayType replacement_array)
+template<typename SequenceA, typename SequenceB, typename Compare, std::size_t... Is>
+constexpr bool nd::detail::all_elements(const SequenceA& a, const SequenceB& b, [[maybe_unused]] Compare compare, std::index_sequence<Is...>)
 {
-    return replacer_t<Rank, ArrayType>(region_to_replace, replacement_array);
+    return (true && ... && compare(a[Is], b[Is]));
 }
 
-
-
-
-/**
- * @brief      Return a select operator starting at the begin index.
- *
- * @param[in]  starting_index  The starting index
- *
- * @tparam     Rank            The rank of the array to operate on
- *
- * @return     The operator
- */
 template<std::size_t Rank>
-auto nd::select_from(index_t<Rank> starting_index)
+auto nd::detail::partition_for_pool(shape_t<Rank> shape, const thread_pool_t& pool)
 {
-    return selector_t<Rank>().from(starting_index);
+    // A few partitions per thread (including the calling thread) so that
+    // uneven per-element costs are smoothed out. These split only axis 0, for
+    // callers relying on the partitions being in row-major element order.
+    return partition_shape(shape, 4 * (pool.size() + 1));
 }
 
-template<typename... Args>
-auto nd::select_from(Args... args)
+template<std::size_t Rank>
+auto nd::detail::tiles_for_pool(shape_t<Rank> shape, const thread_pool_t& pool)
 {
-    return select_from(make_index(args...));
+    // Enough tiles per thread that the threads stay busy when some tiles are
+    // costlier than others, and when axis 0 is shorter than the pool.
+    return partition_tiles(shape, 8 * (pool.size() + 1));
 }
 
-
-
-
-/**
- * @brief      Return a replace operator starting at the begin index.
- *
- * @param[in]  starting_index  The starting index
- *
- * @tparam     Rank            The rank of the array to operate on
- *
- * @return     The operator
- */
-template<std::size_t Rank>
-auto nd::replace_from(index_t<Rank> starting_index)
+template<typename ValueType, typename Function>
+auto nd::detail::reduce_pairwise(std::vector<ValueType> values, Function&& fn, ValueType identity)
 {
-    auto zeros = make_array(make_uniform_provider(0, make_uniform_shape<Rank>(1)));
-    return replacer_t<Rank, decltype(zeros)>({}, zeros).from(starting_index);
+    if (values.empty())
+    {
+        return identity;
+    }
+    while (values.size() > 1)
+    {
+        auto next = std::vector<ValueType>();
+
+        for (std::size_t n = 0; n + 1 < values.size(); n += 2)
+        {
+            next.push_back(fn(values[n], values[n + 1]));
+        }
+        if (values.size() % 2 == 1)
+        {
+            next.push_back(values.back());
+        }
+        values = std::move(next);
+    }
+    return values.front();
 }
 
-template<typename... Args>
-auto nd::replace_from(Args... args)
+template<typename ResultType, typename ArrayType, std::size_t Rank>
+auto nd::detail::sum_region(const ArrayType& array, const access_pattern_t<Rank>& region)
 {
-    return replace_from(make_index(args...));
-}
+    using provider_type = typename std::remove_reference_t<ArrayType>::provider_type;
+    using value_type = std::decay_t<value_type_of<ArrayType>>;
 
+    auto result = ResultType();
+    [[maybe_unused]] auto compensation = ResultType();
 
+    auto add = [&] (const auto& x)
+    {
+        if constexpr (std::is_floating_point<ResultType>::value)
+        {
+            auto y = ResultType(x) - compensation;
+            auto t = result + y;
+            compensation = (t - result) - y;
+            result = t;
+        }
+        else
+        {
+            result += x;
+        }
+    };
 
+    if constexpr (has_evaluate_row<provider_type>::value && std::is_default_constructible<value_type>::value)
+    {
+        auto add_rows = [&] (const access_pattern_t<Rank>& rows)
+        {
+            value_type block[row_block_size];
 
-/**
- * @brief      Reads an index from an array.
- *
- * @param[in]  index_to_read  The index to read
- *
- * @tparam     Rank           The rank of the array that can be read from
- *
- * @return     The operator
- */
-template<std::size_t Rank>
-auto nd::read_index(index_t<Rank> index_to_read)
-{
-    return [index_to_read] (auto&& array)
+            for_each_row(rows, [&] (auto index, std::size_t count)
+            {
+                for (std::size_t k = 0; k < count; k += row_block_size)
+                {
+                    auto n = std::min(row_block_size, count - k);
+                    evaluate_row(array.get_provider(), index, block, n);
+                    index[Rank - 1] += n;
+
+                    for (std::size_t j = 0; j < n; ++j)
+                    {
+                        add(block[j]);
+                    }
+                }
+            });
+        };
+
+        if constexpr (is_block_sparse_provider<provider_type>::value && std::is_arithmetic<value_type>::value)
+        {
+            // Background tiles each add a multiple of the background value.
+            if (all_of(region.jumps, [] (auto j) { return j == 1; }))
+            {
+                const auto& provider = array.get_provider();
+
+                provider.for_each_tile(region, [&] (const auto& part, bool dense)
+                {
+                    if (dense)
+                    {
+                        add_rows(part);
+                    }
+                    else
+                    {
+                        add(ResultType(provider.background()) * ResultType(part.size()));
+                    }
+                });
+                return result;
+            }
+        }
+        if (region.jumps[Rank - 1] == 1)
+        {
+            add_rows(region);
+            return result;
+        }
+    }
+    for (const auto& i : region)
     {
-        return array(index_to_read);
-    };
+        add(array(i));
+    }
+    return result;
 }
 
-template<typename... Args>
-auto nd::read_index(Args... args)
+template<bool FlatOffsets, typename ArrayType, typename Runner>
+auto nd::detail::find_indexes(ArrayType array, const std::vector<access_pattern_t<ArrayType::rank>>& regions, Runner&& run)
 {
-    return read_index(make_index(args...));
-}
+    // The condition is evaluated once, into a mask; each region (a slab of
+    // axis 0, contiguous in row-major order) is masked and counted as one
+    // task. The counts are prefix-summed to find where each region's results
+    // begin, and the results are then scattered in a second pass over the
+    // mask.
+    using result_type = std::conditional_t<FlatOffsets, std::size_t, index_t<ArrayType::rank>>;
 
+    auto bool_array = array | transform([] (auto x) { return bool(x); });
+    auto strides = make_strides_row_major(array.shape());
+    auto mask = buffer_t<bool>(array.size(), uninitialized);
+    auto counts = std::vector<std::size_t>(regions.size());
 
+    run(regions.size(), [&] (std::size_t n)
+    {
+        auto first = mask.data() + strides.compute_offset(regions[n].start);
+        evaluate_slab(bool_array.get_provider(), regions[n], first);
+        counts[n] = std::size_t(std::count(first, first + regions[n].size(), true));
+    });
 
+    auto starts = std::vector<std::size_t>(regions.size());
+    auto total = std::size_t(0);
 
-/**
- * @brief      Return an operator that transforms the values of an array using
- *             the given function object.
- *
- * @param      function  The function
- *
- * @tparam     Function  The type of the function object
- *
- * @return     The operator
- */
-template<typename Function>
-auto nd::transform(Function function)
-{
-    return [function] (auto array)
+    for (std::size_t n = 0; n < regions.size(); ++n)
     {
-        auto mapping = [array, function] (auto&& index) { return function(array(index)); };
-        return make_array(mapping, array.shape());
-    };
-}
+        starts[n] = total;
+        total += counts[n];
+    }
+    auto result = make_unique_provider<result_type>(make_shape(total), uninitialized);
 
+    run(regions.size(), [&] (std::size_t n)
+    {
+        auto begin = strides.compute_offset(regions[n].start);
+        auto target = result.data() + starts[n];
 
+        if constexpr (FlatOffsets)
+        {
+            for (auto offset = begin; offset < begin + regions[n].size(); ++offset)
+            {
+                if (mask[offset])
+                {
+                    *target++ = offset;
+                }
+            }
+        }
+        else
+        {
+            auto offset = begin;
 
+            for (const auto& index : regions[n])
+            {
+                if (mask[offset++])
+                {
+                    *target++ = index;
+                }
+            }
+        }
+    });
+    return make_array(std::move(result).shared());
+}
 
-/**
- * @brief      Return a function that operates on two arrays, given a function
- *             that operates on their value types.
- *
- * @param      function  The function
- *
- * @tparam     Function  The function type
- *
- * @return     The operator
- */
-template<typename Function>
-auto nd::binary_op(Function function)
+template<typename ArrayType, std::size_t Rank, std::size_t SourceRank, typename Runner>
+auto nd::detail::gather_planned(const ArrayType& array, const gather_plan_t<Rank, SourceRank>& plan, std::size_t num_tasks, Runner&& run)
 {
-    return [function] (auto A, auto B)
+    // Each task reads a contiguous part of the plan's sorted offsets, and
+    // writes to the positions they came from; the positions are distinct, so
+    // the tasks write disjoint elements of the result.
+    using value_type = std::decay_t<value_type_of<ArrayType>>;
+    using provider_type = typename std::decay_t<ArrayType>::provider_type;
+    constexpr std::size_t prefetch_distance = 16;
+
+    static_assert(std::decay_t<ArrayType>::rank == SourceRank, "gather plan and array must have the same rank");
+
+    if (array.shape() != plan.source_shape())
     {
-        if (A.shape() != B.shape())
+        throw std::logic_error("array shape does not match the source shape of the gather plan");
+    }
+    auto result = make_unique_provider<value_type>(plan.shape(), uninitialized);
+    auto target = result.data();
+    auto offsets = plan.offsets();
+    auto positions = plan.positions();
+    auto count = plan.size();
+    auto strides = make_strides_row_major(plan.source_shape());
+    auto contiguous = [&array]
+    {
+        if constexpr (is_strided_memory_provider<provider_type>::value)
         {
-            throw std::logic_error("binary operation applied to arrays of different shapes");
+            return array.get_provider().contiguous();
         }
-        auto mapping = [function, A, B] (auto&& index)
+        else
         {
-            return function(A(index), B(index));
-        };
-        return make_array(mapping, A.shape());
+            return is_row_major_memory_provider<provider_type>::value;
+        }
     };
-}
+    NDARRAY_STATS_ACCESS(read_indexes, count);
 
+    run(num_tasks, [&] (std::size_t task)
+    {
+        auto begin = count * task / num_tasks;
+        auto end = count * (task + 1) / num_tasks;
 
+        if constexpr (is_row_major_memory_provider<provider_type>::value || is_strided_memory_provider<provider_type>::value)
+        {
+            if (contiguous())
+            {
+                auto memory = array.data();
+
+                for (auto k = begin; k < end; ++k)
+                {
+                    if (k + prefetch_distance < end)
+                    {
+                        NDARRAY_PREFETCH(memory + offsets[k + prefetch_distance]);
+                    }
+                    target[positions[k]] = memory[offsets[k]];
+                }
+                return;
+            }
+        }
+        for (auto k = begin; k < end; ++k)
+        {
+            target[positions[k]] = array(index_at_offset(offsets[k], strides));
+        }
+    });
+    return make_array(std::move(result).shared());
+}
 
+template<std::size_t Rank>
+auto nd::detail::index_at_offset(std::size_t offset, const memory_strides_t<Rank>& strides)
+{
+    // The index of the element at the given offset, for row-major strides.
+    auto index = index_t<Rank>();
 
-//=============================================================================
-// More array factories, which must be defined after the operator factories
-//=============================================================================
+    for (std::size_t n = 0; n < Rank; ++n)
+    {
+        index[n] = offset / strides[n];
+        offset -= index[n] * strides[n];
+    }
+    return index;
+}
 
+template<typename ResultType, typename ArrayType, std::size_t Rank>
+auto nd::detail::sum_tiles(const ArrayType& array, const access_pattern_t<Rank>& region, const shape_t<Rank>& tile_shape)
+{
+    auto partials = std::vector<ResultType>();
 
+    for (const auto& tile : region.tiled(tile_shape))
+    {
+        partials.push_back(sum_region<ResultType>(array, tile));
+    }
+    return reduce_pairwise(std::move(partials), std::plus<>(), ResultType());
+}
 
+template<typename TargetArrayType, typename SourceArrayType>
+void nd::detail::check_evaluation_target(const TargetArrayType& target, const SourceArrayType& source)
+{
+    using value_type = typename TargetArrayType::value_type;
+    static_assert(is_unique_provider<typename TargetArrayType::provider_type>::value,
+        "the target of evaluate_into must be a unique array");
+    static_assert(std::is_same<std::decay_t<value_type_of<SourceArrayType>>, value_type>::value,
+        "the source of evaluate_into must have the target's value type");
+    static_assert(SourceArrayType::rank == TargetArrayType::rank,
+        "the source of evaluate_into must have the target's rank");
+
+    if (target.shape() != source.shape())
+    {
+        throw std::logic_error("cannot evaluate an array into a unique array of a different shape");
+    }
+}
 
-/**
- * @brief      Return a 1d array of containing the indexes where the given array
- *             evaluates to true
- *
- * @param      array      The array
- *
- * @tparam     ArrayType  The type of the argument array
- *
- * @return     An immutable, memory-backed 1d array of index_t<rank>, where rank
- *             is the rank of the argument array
- */
-template<typename ArrayType>
-auto nd::where(ArrayType array)
+template<typename ArrayType, typename Sink, typename Evaluator>
+void nd::detail::stream_chunks(const ArrayType& array, std::size_t rows_per_chunk, Sink& sink, Evaluator&& evaluate)
 {
-    auto bool_array = array | transform([] (auto x) { return bool(x); });
-    auto index_list = make_unique_array<index_t<rank(bool_array)>>(bool_array | sum());
+    // Each chunk is a slab of whole rows, evaluated into a buffer sized for
+    // the largest chunk; the buffer's row-major strides on the trailing axes
+    // are those of every chunk, including a shorter last one.
+    using value_type = std::decay_t<value_type_of<ArrayType>>;
 
-    std::size_t n = 0;
+    if (rows_per_chunk == 0)
+    {
+        throw std::logic_error("evaluate_in_chunks needs at least one row per chunk");
+    }
+    auto shape = array.shape();
+    auto buffer_shape = shape;
+    buffer_shape[0] = std::min(rows_per_chunk, shape[0]);
 
-    for (auto index : bool_array.indexes())
+    auto buffer = buffer_t<value_type>(buffer_shape.volume(), uninitialized);
+
+    for (std::size_t i = 0; i < shape[0]; i += rows_per_chunk)
     {
-        if (bool_array(index))
+        auto region = make_access_pattern(shape);
+        region.start[0] = i;
+        region.final[0] = std::min(i + rows_per_chunk, shape[0]);
+
         {
-            index_list(n++) = index;
+            NDARRAY_STATS_TIMER(evaluation_nanoseconds);
+            NDARRAY_STATS_ADD(evaluations, 1);
+            NDARRAY_STATS_ADD(evaluated_elements, region.size());
+            evaluate(region, buffer.data());
         }
+        sink(static_cast<const access_pattern_t<ArrayType::rank>&>(region), make_view(static_cast<const value_type*>(buffer.data()), region.shape()));
     }
-    return index_list.shared();
 }
 
+template<typename Provider, std::size_t Rank, typename ValueType, typename Runner>
+auto nd::detail::make_block_sparse(const Provider& source, shape_t<Rank> tile_shape, ValueType background, Runner&& run)
+{
+    // Each tile is evaluated into a buffer padded with the background value,
+    // and kept only if some element differs from the background.
+    if (any_of(tile_shape, [] (auto s) { return s == 0; }))
+    {
+        throw std::logic_error("tiles must have a non-zero extent on each axis");
+    }
+    auto shape = source.shape();
+    auto tile_counts = shape_t<Rank>();
+
+    for (std::size_t n = 0; n < Rank; ++n)
+    {
+        tile_counts[n] = (shape[n] + tile_shape[n] - 1) / tile_shape[n];
+    }
+    auto tile_indexes = std::vector<index_t<Rank>>();
+    auto tile_strides = make_strides_row_major(tile_shape);
 
+    for (const auto& tile : make_access_pattern(tile_counts))
+    {
+        tile_indexes.push_back(tile);
+    }
+    auto tiles = std::vector<buffer_t<ValueType>>(tile_indexes.size());
 
+    NDARRAY_STATS_TIMER(evaluation_nanoseconds);
+    NDARRAY_STATS_ADD(evaluations, 1);
+    NDARRAY_STATS_ADD(evaluated_elements, shape.volume());
 
-//=============================================================================
-// The array class itself
-//=============================================================================
+    run(tiles.size(), [&] (std::size_t n)
+    {
+        auto region = access_pattern_t<Rank>();
+        auto buffer = buffer_t<ValueType>(tile_shape.volume(), background);
 
+        for (std::size_t k = 0; k < Rank; ++k)
+        {
+            region.start[k] = tile_indexes[n][k] * tile_shape[k];
+            region.final[k] = std::min(shape[k], region.start[k] + tile_shape[k]);
+        }
+        for_each_row(region, [&] (const auto& index, std::size_t count)
+        {
+            auto local = index;
 
+            for (std::size_t k = 0; k < Rank; ++k)
+            {
+                local[k] -= region.start[k];
+            }
+            evaluate_row(source, index, buffer.data() + tile_strides.compute_offset(local), count);
+        });
 
+        if (! all_of(buffer, [&background] (const auto& x) { return x == background; }))
+        {
+            tiles[n] = std::move(buffer);
+        }
+    });
+    return block_sparse_provider_t<Rank, ValueType>(shape, tile_shape, std::move(background), std::move(tiles));
+}
 
-/**
- * @brief      The actual array class template
- *
- * @tparam     Rank      The array dimensionality
- * @tparam     Provider  Type defining the index space and mapping from indexes
- *                       to values
- */
-template<typename Provider>
-class nd::array_t
+template<typename Provider, typename Runner, std::size_t... Is>
+auto nd::detail::make_soa(const Provider& source, const std::vector<access_pattern_t<Provider::rank>>& regions, Runner&& run, std::index_sequence<Is...>)
 {
-public:
-
-    using provider_type = Provider;
+    // The arrays zipped by zip_arrays are each evaluated straight into their
+    // component's buffer. Other sources are evaluated a block of tuples of a
+    // row at a time, and each block is scattered into the component buffers.
     using value_type = typename Provider::value_type;
-    static constexpr std::size_t rank = Provider::rank;
+    constexpr std::size_t Rank = Provider::rank;
+    static_assert(std::is_default_constructible<value_type>::value, "to_shared_soa needs default-constructible components");
 
-    //=========================================================================
-    array_t(Provider&& provider) : provider(std::move(provider)) {}
+    auto shape = source.shape();
+    auto strides = make_strides_row_major(shape);
+    auto buffers = std::make_tuple(std::make_shared<buffer_t<std::tuple_element_t<Is, value_type>>>(shape.volume(), uninitialized)...);
+    auto targets = std::make_tuple(std::get<Is>(buffers)->data()...);
 
-    // indexing functions
-    //=========================================================================
-    template<typename... Args> decltype(auto) operator()(Args... args) const { return provider(make_index(args...)); }
-    template<typename... Args> decltype(auto) operator()(Args... args)       { return provider(make_index(args...)); }
-    decltype(auto) operator()(const index_t<rank>& index) const { return provider(index); }
-    decltype(auto) operator()(const index_t<rank>& index)       { return provider(index); }
-    decltype(auto) data() const { return provider.data(); }
-    decltype(auto) data()       { return provider.data(); }
+    NDARRAY_STATS_TIMER(evaluation_nanoseconds);
+    NDARRAY_STATS_ADD(evaluations, 1);
+    NDARRAY_STATS_ADD(evaluated_elements, shape.volume());
 
-    // query functions and operator support
-    //=========================================================================
-    auto shape() const { return provider.shape(); }
-    auto shape(std::size_t axis) const { return provider.shape()[axis]; }
-    auto size() const { return provider.size(); }
-    const Provider& get_provider() const { return provider; }
-    auto indexes() const { return make_access_pattern(provider.shape()); }
-    template<typename Function> auto operator|(Function&& fn) const & { return fn(*this); }
-    template<typename Function> auto operator|(Function&& fn)      && { return fn(std::move(*this)); }
+    run(regions.size(), [&] (std::size_t n)
+    {
+        if constexpr (is_zip_provider<Provider>::value)
+        {
+            const auto& arrays = source.get_mapping().get_arrays();
+            (evaluate_region(std::get<Is>(arrays).get_provider(), regions[n], std::get<Is>(targets)), ...);
+            return;
+        }
+        for_each_row(regions[n], [&] (auto index, std::size_t count)
+        {
+            value_type block[row_block_size];
+            auto offset = strides.compute_offset(index);
 
-    // methods converting this to a memory-backed array
-    //=========================================================================
-    auto unique() const { return make_array(evaluate_as_unique(provider)); }
-    auto shared() const { return make_array(evaluate_as_shared(provider)); }
+            for (std::size_t k = 0; k < count; k += row_block_size)
+            {
+                auto m = std::min(row_block_size, count - k);
+                evaluate_row(source, index, block, m);
+                index[Rank - 1] += m;
+
+                for (std::size_t j = 0; j < m; ++j)
+                {
+                    ((std::get<Is>(targets)[offset + k + j] = std::move(std::get<Is>(block[j]))), ...);
+                }
+            }
+        });
+    });
+    using provider_type = soa_provider_t<Rank, std::tuple_element_t<Is, value_type>...>;
+    return provider_type(std::make_tuple(shared_provider_t<Rank, std::tuple_element_t<Is, value_type>>(shape, std::get<Is>(buffers))...));
+}
 
-    // arithmetic operators
-    //=========================================================================
-    template<typename T> auto operator+(T&& A) const { return bin_op(std::forward<T>(A), std::plus<>()); }
-    template<typename T> auto operator-(T&& A) const { return bin_op(std::forward<T>(A), std::minus<>()); }
-    template<typename T> auto operator*(T&& A) const { return bin_op(std::forward<T>(A), std::multiplies<>()); }
-    template<typename T> auto operator/(T&& A) const { return bin_op(std::forward<T>(A), std::divides<>()); }
-    template<typename T> auto operator&&(T&& A) const { return bin_op(std::forward<T>(A), std::logical_and<>()); }
-    template<typename T> auto operator||(T&& A) const { return bin_op(std::forward<T>(A), std::logical_or<>()); }
-    template<typename T> auto operator==(T&& A) const { return bin_op(std::forward<T>(A), std::equal_to<>()); }
-    template<typename T> auto operator!=(T&& A) const { return bin_op(std::forward<T>(A), std::not_equal_to<>()); }
-    template<typename T> auto operator<=(T&& A) const { return bin_op(std::forward<T>(A), std::less_equal<>()); }
-    template<typename T> auto operator>=(T&& A) const { return bin_op(std::forward<T>(A), std::greater_equal<>()); }
-    template<typename T> auto operator<(T&& A) const { return bin_op(std::forward<T>(A), std::less<>()); }
-    template<typename T> auto operator>(T&& A) const { return bin_op(std::forward<T>(A), std::greater<>()); }
-    template<typename T> auto operator-() const { return transform(std::negate<>()); }
-    template<typename T> auto operator!() const { return transform(std::logical_not<>()); }
+template<typename ArrayType, std::size_t... Is>
+auto nd::detail::unzip_components(const ArrayType& array, std::index_sequence<Is...>)
+{
+    if constexpr (is_soa_provider<typename ArrayType::provider_type>::value)
+    {
+        return std::make_tuple(make_array(array.get_provider().template component<Is>())...);
+    }
+    else
+    {
+        return std::make_tuple((array | transform([] (const auto& value) { return std::get<Is>(value); }))...);
+    }
+}
 
-private:
-    //=========================================================================
-    template<typename OtherType, typename Function>
-    auto bin_op(OtherType&& other, Function&& function) const
+template<typename Provider, std::size_t Rank, typename ValueType>
+void nd::detail::evaluate_slab(const Provider& source, const access_pattern_t<Rank>& slab, ValueType* target)
+{
+    // The slab must be a contiguous range of the source's axis 0, spanning
+    // all of its other axes; its elements are then adjacent in row-major
+    // order, and are written consecutively to the target.
+    if (slab.empty())
     {
-        auto F = binary_op(std::forward<Function>(function));
-        auto B = promote(std::forward<OtherType>(other), shape());
-        return F(*this, std::move(B));
+        return;
     }
-    Provider provider;
-};
+    if constexpr (is_row_major_memory_provider<std::remove_cv_t<Provider>>::value)
+    {
+        auto source_strides = make_strides_row_major(source.shape());
+        auto first = source.data() + source_strides.compute_offset(slab.start);
+        auto count = slab.size();
 
+        if constexpr (std::is_trivially_copyable<ValueType>::value)
+        {
+            std::memcpy(target, first, count * sizeof(ValueType));
+        }
+        else
+        {
+            std::copy(first, first + count, target);
+        }
+    }
+    else
+    {
+        if constexpr (is_strided_memory_provider<std::remove_cv_t<Provider>>::value)
+        {
+            if (source.contiguous())
+            {
+                auto first = source.data() + source.strides().compute_offset(slab.start);
+                auto count = slab.size();
+
+                if constexpr (std::is_trivially_copyable<ValueType>::value)
+                {
+                    std::memcpy(target, first, count * sizeof(ValueType));
+                }
+                else
+                {
+                    std::copy(first, first + count, target);
+                }
+                return;
+            }
+            if constexpr (Rank > 1)
+            {
+                // If some other axis has a shorter stride than the last (as
+                // for views made by permute_axes), rows read memory far
+                // apart. Copying in square blocks over the last axis and the
+                // axis with the shortest stride re-uses each cache line read.
+                auto strides = source.strides();
+                auto shortest = Rank - 1;
+
+                for (std::size_t n = 0; n < Rank - 1; ++n)
+                {
+                    if (source.shape()[n] > 1 && strides[n] < strides[shortest])
+                    {
+                        shortest = n;
+                    }
+                }
+                if (shortest != Rank - 1)
+                {
+                    auto tile_shape = make_uniform_shape<Rank>(1);
+                    tile_shape[Rank - 1] = transpose_block_size;
+                    tile_shape[shortest] = transpose_block_size;
+                    evaluate_slab(source, slab, tile_shape, target);
+                    return;
+                }
+            }
+        }
+        for_each_row(slab, [&] (const auto& index, std::size_t count)
+        {
+            evaluate_row(source, index, target, count);
+            target += count;
+        });
+    }
+}
 
+template<typename Provider, std::size_t Rank, typename ValueType>
+void nd::detail::evaluate_slab(const Provider& source, const access_pattern_t<Rank>& slab, const shape_t<Rank>& tile_shape, ValueType* target)
+{
+    // As above, but the slab is visited one tile at a time. Each row of a tile
+    // is written to its row-major place in the target. Memory that can be
+    // copied linearly gains nothing from tiling.
+    if constexpr (is_row_major_memory_provider<std::remove_cv_t<Provider>>::value)
+    {
+        evaluate_slab(source, slab, target);
+    }
+    else
+    {
+        if constexpr (is_strided_memory_provider<std::remove_cv_t<Provider>>::value)
+        {
+            if (source.contiguous())
+            {
+                evaluate_slab(source, slab, target);
+                return;
+            }
+        }
+        auto target_strides = make_strides_row_major(source.shape());
+        auto origin = target_strides.compute_offset(slab.start);
 
+        for (const auto& tile : slab.tiled(tile_shape))
+        {
+            for_each_row(tile, [&] (const auto& index, std::size_t count)
+            {
+                evaluate_row(source, index, target + (target_strides.compute_offset(index) - origin), count);
+            });
+        }
+    }
+}
 
-//=============================================================================
-// Helper functions
-//=============================================================================
+template<typename Provider, std::size_t Rank, typename ValueType>
+void nd::detail::evaluate_region(const Provider& source, const access_pattern_t<Rank>& region, ValueType* target)
+{
+    // Evaluate a region of any shape, such as one of the tiles made by
+    // partition_tiles, into its row-major place in the target; here target
+    // points to the start of the whole array. Regions spanning all but the
+    // leading axis are contiguous, and are evaluated as slabs.
+    auto target_strides = make_strides_row_major(source.shape());
 
+    if (is_slab(region, source.shape()))
+    {
+        evaluate_slab(source, region, target + target_strides.compute_offset(region.start));
+        return;
+    }
+    for_each_row(region, [&] (const auto& index, std::size_t count)
+    {
+        evaluate_row(source, index, target + target_strides.compute_offset(index), count);
+    });
+}
 
+template<typename Provider, std::size_t Rank, typename ValueType>
+void nd::detail::evaluate_region(const Provider& source, const access_pattern_t<Rank>& region, const shape_t<Rank>& tile_shape, ValueType* target)
+{
+    auto target_strides = make_strides_row_major(source.shape());
 
+    if (is_slab(region, source.shape()))
+    {
+        evaluate_slab(source, region, tile_shape, target + target_strides.compute_offset(region.start));
+        return;
+    }
+    for (const auto& tile : region.tiled(tile_shape))
+    {
+        evaluate_region(source, tile, target);
+    }
+}
 
-template<typename Function, typename Tuple, std::size_t... Is>
-auto nd::detail::transform_tuple_impl(Function&& fn, const Tuple& t, std::index_sequence<Is...>)
+template<std::size_t Rank>
+bool nd::detail::is_slab(const access_pattern_t<Rank>& region, const shape_t<Rank>& shape)
 {
-    return std::make_tuple(fn(std::get<Is>(t))...);
+    for (std::size_t n = 0; n < Rank; ++n)
+    {
+        if (region.jumps[n] != 1 || (n > 0 && (region.start[n] != 0 || region.final[n] != shape[n])))
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
-template<typename Function, typename Tuple>
-auto nd::detail::transform_tuple(Function&& fn, const Tuple& t)
+template<typename Provider, std::size_t Rank, typename ValueType>
+void nd::detail::evaluate_row(const Provider& provider, const index_t<Rank>& index, ValueType* target, std::size_t count)
 {
-    return transform_tuple_impl(std::forward<Function>(fn), t, std::make_index_sequence<std::tuple_size<Tuple>::value>());
+    if constexpr (has_evaluate_row<Provider>::value)
+    {
+        provider.evaluate_row(index, target, count);
+    }
+    else
+    {
+        auto i = index;
+
+        for (std::size_t k = 0; k < count; ++k, ++i[Rank - 1])
+        {
+            target[k] = provider(i);
+        }
+    }
 }
 
-template<typename FunctionTuple, typename ArgumentTuple, std::size_t... Is>
-auto nd::detail::zip_apply_tuple_impl(FunctionTuple&& fn, ArgumentTuple&& args, std::index_sequence<Is...>)
+template<std::size_t Rank, typename Function>
+void nd::detail::for_each_row(const access_pattern_t<Rank>& region, Function&& fn)
 {
-    return std::make_tuple(std::get<Is>(fn)(std::get<Is>(args))...);
+    // Calls fn(index, count) with the first index of each row of the region
+    // lying along the last axis. Requires unit jumps on the last axis.
+    if (region.empty())
+    {
+        return;
+    }
+    auto rows = region;
+    rows.final[Rank - 1] = region.start[Rank - 1] + 1;
+
+    for (const auto& index : rows)
+    {
+        fn(index, region.final[Rank - 1] - region.start[Rank - 1]);
+    }
 }
 
-template<typename FunctionTuple, typename ArgumentTuple>
-auto nd::detail::zip_apply_tuple(FunctionTuple&& fn, ArgumentTuple&& args)
+template<typename Provider, std::size_t Rank, typename ValueType>
+const ValueType* nd::detail::read_row(const Provider& provider, const index_t<Rank>& index, ValueType* block, std::size_t count)
 {
-    return zip_apply_tuple_impl(
-        std::forward<FunctionTuple>(fn),
-        std::forward<ArgumentTuple>(args),
-        std::make_index_sequence<std::tuple_size<ArgumentTuple>::value>());
+    // Returns a pointer to count consecutive values along the last axis: the
+    // provider's own memory if it is row-major, otherwise the given block,
+    // after filling it.
+    if constexpr (is_row_major_memory_provider<Provider>::value)
+    {
+        return provider.data() + make_strides_row_major(provider.shape()).compute_offset(index);
+    }
+    else
+    {
+        if constexpr (is_strided_memory_provider<Provider>::value)
+        {
+            if (provider.strides()[Rank - 1] == 1 && provider.data())
+            {
+                return provider.data() + provider.strides().compute_offset(index);
+            }
+        }
+        evaluate_row(provider, index, block, count);
+        return block;
+    }
 }
 
-template<typename ResultSequence, typename SourceSequence, typename IndexContainer>
-auto nd::detail::read_elements(const SourceSequence& source, IndexContainer indexes)
+template<typename Function, typename ValueType, typename... SourceTypes>
+void nd::detail::apply_elementwise(const Function& function, ValueType* target, std::size_t count, const SourceTypes*... sources)
 {
-    auto target_n = std::size_t(0);
-    auto result = ResultSequence();
+    auto n = std::size_t(0);
 
-    for (std::size_t n = 0; n < source.size(); ++n)
+    if constexpr (
+        is_vectorized_function<Function>::value &&
+        std::is_floating_point<ValueType>::value &&
+        (std::is_same<SourceTypes, ValueType>::value && ...))
     {
-        if (std::find(std::begin(indexes), std::end(indexes), n) != std::end(indexes))
+        using pack_type = simd_pack_t<ValueType, simd_width<ValueType>>;
+
+        for (; n + pack_type::width <= count; n += pack_type::width)
         {
-            result[target_n++] = source[n];
+            function(pack_type::load(sources + n)...).store(target + n);
         }
     }
-    return result;
+    for (; n < count; ++n)
+    {
+        target[n] = function(sources[n]...);
+    }
 }
 
-template<typename ResultSequence, typename SourceSequence, typename IndexContainer, typename Sequence>
-auto nd::detail::insert_elements(const SourceSequence& source, IndexContainer indexes, Sequence values)
+template<typename ValueType>
+std::string nd::detail::npy_descr()
 {
-    static_assert(indexes.size() == values.size());
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    auto endian = std::string(">");
+#else
+    auto endian = std::string("<");
+#endif
+    auto bytes = std::to_string(sizeof(ValueType));
+
+    if constexpr (std::is_same<ValueType, bool>::value)
+    {
+        return "|b1";
+    }
+    else if constexpr (std::is_floating_point<ValueType>::value)
+    {
+        return endian + "f" + bytes;
+    }
+    else if constexpr (std::is_integral<ValueType>::value)
+    {
+        return (sizeof(ValueType) == 1 ? "|" : endian) + (std::is_signed<ValueType>::value ? "i" : "u") + bytes;
+    }
+    else
+    {
+        static_assert(std::is_arithmetic<ValueType>::value, "only arithmetic value types can be stored in .npy files");
+        return "";
+    }
+}
 
-    auto source1_n = std::size_t(0);
-    auto source2_n = std::size_t(0);
-    auto result = ResultSequence();
+template<std::size_t Rank>
+std::string nd::detail::make_npy_header(const std::string& descr, shape_t<Rank> shape)
+{
+    auto shape_string = std::string("(");
 
-    for (std::size_t n = 0; n < result.size(); ++n)
+    for (auto n : shape)
     {
-        if (std::find(std::begin(indexes), std::end(indexes), n) == std::end(indexes))
+        shape_string += std::to_string(n) + (Rank == 1 ? ",)" : ", ");
+    }
+    if (Rank > 1)
+    {
+        shape_string.resize(shape_string.size() - 2);
+        shape_string += ")";
+    }
+    auto dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': " + shape_string + ", }";
+    auto preamble_size = std::size_t(10);
+    auto padded_size = (preamble_size + dict.size() + 1 + 63) / 64 * 64;
+
+    if (padded_size - preamble_size > 0xffff)
+    {
+        throw std::runtime_error("npy header is too long");
+    }
+    dict.resize(padded_size - preamble_size - 1, ' ');
+    dict += '\n';
+
+    auto header_size = dict.size();
+    auto result = std::string("\x93NUMPY\x01\x00", 8);
+    result += char(header_size & 0xff);
+    result += char(header_size >> 8);
+    return result + dict;
+}
+
+nd::detail::npy_header_t nd::detail::read_npy_header(std::istream& stream)
+{
+    char preamble[8];
+
+    if (! stream.read(preamble, 8) || std::string(preamble, 6) != "\x93NUMPY")
+    {
+        throw std::runtime_error("not a .npy file");
+    }
+    auto length_bytes = preamble[6] == 1 ? 2 : 4;
+    unsigned char length_data[4] = {0, 0, 0, 0};
+
+    if (! stream.read(reinterpret_cast<char*>(length_data), length_bytes))
+    {
+        throw std::runtime_error("truncated .npy header");
+    }
+    auto length = std::size_t(length_data[0]) | std::size_t(length_data[1]) << 8 | std::size_t(length_data[2]) << 16 | std::size_t(length_data[3]) << 24;
+    auto dict = std::string(length, ' ');
+
+    if (! stream.read(dict.data(), length))
+    {
+        throw std::runtime_error("truncated .npy header");
+    }
+    auto value_of = [&dict] (const std::string& key)
+    {
+        auto n = dict.find("'" + key + "'");
+
+        if (n == std::string::npos || (n = dict.find(':', n)) == std::string::npos)
         {
-            result[n] = source[source1_n++];
+            throw std::runtime_error("missing key in .npy header: " + key);
         }
-        else
+        return dict.substr(dict.find_first_not_of(' ', n + 1));
+    };
+    auto header = npy_header_t();
+    auto descr = value_of("descr");
+    auto shape = value_of("shape");
+
+    header.descr = descr.substr(1, descr.find(descr[0], 1) - 1);
+    header.fortran_order = value_of("fortran_order").compare(0, 4, "True") == 0;
+    header.data_offset = 8 + length_bytes + length;
+
+    for (auto n = shape.find_first_of("0123456789)"); ; n = shape.find_first_of("0123456789)", n))
+    {
+        if (n == std::string::npos)
         {
-            result[n] = values[source2_n++];
+            throw std::runtime_error("malformed .npy shape");
+        }
+        if (shape[n] == ')')
+        {
+            break;
         }
+        auto digits = shape.find_first_not_of("0123456789", n);
+
+        if (digits == std::string::npos)
+        {
+            throw std::runtime_error("malformed .npy shape");
+        }
+        header.shape.push_back(std::stoull(shape.substr(n, digits - n)));
+        n = digits;
     }
-    return result;
+    return header;
 }
 
-template<typename ResultSequence, typename SourceSequence, typename IndexContainer>
-auto nd::detail::remove_elements(const SourceSequence& source, IndexContainer indexes)
+template<typename ValueType, std::size_t Rank>
+nd::shape_t<Rank> nd::detail::validate_npy_header(const npy_header_t& header)
 {
-    auto target_n = std::size_t(0);
-    auto result = ResultSequence();
-
-    for (std::size_t n = 0; n < source.size(); ++n)
+    if (header.descr != npy_descr<ValueType>())
     {
-        if (std::find(std::begin(indexes), std::end(indexes), n) == std::end(indexes))
-        {
-            result[target_n++] = source[n];
-        }
+        throw std::runtime_error("the .npy file has value type " + header.descr + ", expected " + npy_descr<ValueType>());
     }
-    return result;
+    if (header.fortran_order)
+    {
+        throw std::runtime_error("the .npy file is stored in column-major order");
+    }
+    if (header.shape.size() != Rank)
+    {
+        throw std::runtime_error("the .npy file has rank " + std::to_string(header.shape.size()));
+    }
+    return shape_t<Rank>::from_range(header.shape);
 }
@@ -0,0 +1,410 @@
+/**
+ ==============================================================================
+ Copyright 2019, Jonathan Zrake
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+ this software and associated documentation files (the "Software"), to deal in
+ the Software without restriction, including without limitation the rights to
+ use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ of the Software, and to permit persons to whom the Software is furnished to do
+ so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ ==============================================================================
+*/
+
+
+
+
+#pragma once
+#include <limits>            // std::numeric_limits
+#include <stdexcept>         // std::overflow_error
+#include <mpi.h>
+#include "ndarray.hpp"
+
+
+
+
+//=============================================================================
+namespace nd::mpi
+{
+
+
+    // distributed array types
+    //=========================================================================
+    template<std::size_t Rank, typename ValueType> class distributed_array_t;
+
+
+    // distributed array factory functions
+    //=========================================================================
+    template<typename ArrayType> auto distribute(MPI_Comm comm, const ArrayType& global_array, std::size_t guard, bool periodic=false);
+}
+
+
+
+
+/**
+ * An array whose global shape is decomposed along axis 0 into contiguous
+ * blocks of rows, one per process of an MPI communicator. Each process holds
+ * its own block in a memory-backed array, padded on axis 0 by guard rows on
+ * either side (ghost zones), which exchange() fills with the edge rows of the
+ * neighbouring blocks. On a non-periodic domain, the guard rows beyond the
+ * ends of axis 0 are zero.
+ *
+ * Lazy pipelines are applied to the padded local block with map(fn), or with
+ * exchange_and_map(fn), which overlaps the ghost exchange with evaluation of
+ * the rows that do not depend on ghost data. Like every other array, a
+ * distributed array is immutable: these functions return a new one.
+ */
+//=============================================================================
+template<std::size_t Rank, typename ValueType>
+class nd::mpi::distributed_array_t
+{
+public:
+
+    using value_type = ValueType;
+    static constexpr std::size_t rank = Rank;
+
+    static_assert(std::is_trivially_copyable<ValueType>::value, "distributed arrays must have a trivially copyable value type");
+
+    //=========================================================================
+    distributed_array_t(MPI_Comm comm, shape_t<Rank> global_shape, std::size_t guard, bool periodic=false)
+    : comm(comm)
+    , the_global_shape(global_shape)
+    , guard(guard)
+    , periodic(periodic)
+    , storage(make_shared_array<ValueType>(make_uniform_shape<Rank>(0)))
+    {
+        int process, num_processes;
+        MPI_Comm_rank(comm, &process);
+        MPI_Comm_size(comm, &num_processes);
+
+        auto blocks = partition_shape(global_shape, num_processes);
+
+        if (blocks.size() != std::size_t(num_processes))
+        {
+            throw std::logic_error("a distributed array needs at least one row on axis 0 for each process");
+        }
+        if (std::any_of(blocks.begin(), blocks.end(), [guard] (auto b) { return b.shape()[0] < guard; }))
+        {
+            throw std::logic_error("each process must own at least as many rows as there are guard rows");
+        }
+        region = blocks[process];
+        lower = process > 0 ? process - 1 : (periodic ? num_processes - 1 : MPI_PROC_NULL);
+        upper = process < num_processes - 1 ? process + 1 : (periodic ? 0 : MPI_PROC_NULL);
+        storage = make_shared_array<ValueType>(padded_shape(global_shape));
+    }
+
+    /**
+     * The shape of the whole array, and the region of it owned by this
+     * process.
+     */
+    auto global_shape() const { return the_global_shape; }
+    auto local_region() const { return region; }
+    auto guard_rows() const { return guard; }
+    bool is_periodic() const { return periodic; }
+    bool has_valid_guard() const { return guard_is_valid; }
+
+    /**
+     * The rows owned by this process, without and with the guard rows.
+     */
+    auto local() const { return storage | select_axis(0).from(guard).to(guard + owned_rows()); }
+    auto local_with_guard() const { return storage; }
+
+    /**
+     * Return a copy of this array with its guard rows filled from the
+     * neighbouring processes. This is a collective operation.
+     */
+    auto exchange() const
+    {
+        auto halo = post_exchange();
+        halo.wait();
+        return with_storage(guarded(halo) | to_shared(), true);
+    }
+
+    /**
+     * Return the distributed array obtained by applying fn to the padded local
+     * block of this one. The guard rows must be valid (see exchange).
+     *
+     * The result of fn may have fewer rows than the padded block, provided it
+     * loses the same number r from each side of axis 0: a symmetric stencil
+     * (nd::stencil, a centred select_axis, or a pair of opposite shift_by's
+     * followed by such a select) consumes r of the guard rows on each side.
+     * One-sided pipelines, such as a single shift_by, are rejected. The rows
+     * corresponding to this process's own rows are kept. fn may not consume
+     * more rows than there are guard rows. The guard rows of the result are
+     * not valid.
+     */
+    template<typename Function>
+    auto map(Function&& fn) const
+    {
+        if (! guard_is_valid)
+        {
+            throw std::logic_error("map needs valid guard rows; call exchange first, or use exchange_and_map");
+        }
+        auto result = fn(storage);
+        auto target = make_target(result);
+        evaluate_rows(result, 0, owned_rows(), target);
+        return with_storage(std::move(target).shared(), false);
+    }
+
+    /**
+     * Equivalent to exchange().map(fn), but evaluates the rows not reaching
+     * into the guard zones while the ghost data is in transit, and then the
+     * rows near the edges of the block. This is a collective operation.
+     */
+    template<typename Function>
+    auto exchange_and_map(Function&& fn) const
+    {
+        auto halo = post_exchange();
+        auto interior = fn(storage);
+        auto r = radius(interior.shape());
+        auto n = owned_rows();
+        auto target = make_target(interior);
+
+        evaluate_rows(interior, r, n - r, target);
+        halo.wait();
+
+        auto edges = fn(guarded(halo));
+        evaluate_rows(edges, 0, r, target);
+        evaluate_rows(edges, n - r, n, target);
+        return with_storage(std::move(target).shared(), false);
+    }
+
+    /**
+     * Return the whole array on every process. This is a collective
+     * operation.
+     */
+    auto gather() const
+    {
+        int num_processes;
+        MPI_Comm_size(comm, &num_processes);
+
+        // Counts and displacements are in rows, so that they stay within
+        // the range of int for arrays well beyond 2 GB.
+        auto blocks = partition_shape(the_global_shape, num_processes);
+        auto counts = std::vector<int>();
+        auto offsets = std::vector<int>();
+
+        for (const auto& block : blocks)
+        {
+            counts.push_back(checked_count(block.shape()[0]));
+            offsets.push_back(checked_count(block.start[0]));
+        }
+        auto result = make_unique_array<ValueType>(the_global_shape);
+        auto first = storage.data() + guard * row_size();
+        auto row_type = make_row_type();
+
+        MPI_Allgatherv(first, counts[rank_in(comm)], row_type, result.data(), counts.data(), offsets.data(), row_type, comm);
+        MPI_Type_free(&row_type);
+        return std::move(result).shared();
+    }
+
+private:
+    //=========================================================================
+    struct halo_t
+    {
+        void wait() { MPI_Waitall(4, requests, MPI_STATUSES_IGNORE); }
+        std::vector<ValueType> lower_rows;
+        std::vector<ValueType> upper_rows;
+        MPI_Request requests[4];
+    };
+
+    template<std::size_t, typename> friend class distributed_array_t;
+    template<typename ArrayType> friend auto nd::mpi::distribute(MPI_Comm, const ArrayType&, std::size_t, bool);
+
+    static int rank_in(MPI_Comm comm)
+    {
+        int process;
+        MPI_Comm_rank(comm, &process);
+        return process;
+    }
+
+    std::size_t owned_rows() const { return region.shape()[0]; }
+    std::size_t row_size() const { return the_global_shape.volume() / the_global_shape[0]; }
+
+    auto make_row_type() const
+    {
+        // A datatype for one row of the global array (all axes but 0).
+        MPI_Datatype row_type;
+        MPI_Type_contiguous(checked_count(row_size() * sizeof(ValueType)), MPI_BYTE, &row_type);
+        MPI_Type_commit(&row_type);
+        return row_type;
+    }
+
+    static int checked_count(std::size_t count)
+    {
+        if (count > std::size_t(std::numeric_limits<int>::max()))
+        {
+            throw std::overflow_error("a message count does not fit in an MPI int count");
+        }
+        return int(count);
+    }
+
+    auto padded_shape(shape_t<Rank> shape) const
+    {
+        shape[0] = owned_rows() + 2 * guard;
+        return shape;
+    }
+
+    auto post_exchange() const
+    {
+        // Guard rows travel in both directions at once: the lowest owned rows
+        // become the upper guard of the lower neighbour (tag 0), and the
+        // highest owned rows the lower guard of the upper neighbour (tag 1).
+        auto halo = halo_t{std::vector<ValueType>(guard * row_size()), std::vector<ValueType>(guard * row_size()), {}};
+        auto count = checked_count(guard);
+        auto first = storage.data();
+        auto row_type = make_row_type();
+
+        MPI_Irecv(halo.lower_rows.data(), count, row_type, lower, 1, comm, &halo.requests[0]);
+        MPI_Irecv(halo.upper_rows.data(), count, row_type, upper, 0, comm, &halo.requests[1]);
+        MPI_Isend(first + guard * row_size(), count, row_type, lower, 0, comm, &halo.requests[2]);
+        MPI_Isend(first + owned_rows() * row_size(), count, row_type, upper, 1, comm, &halo.requests[3]);
+
+        // The type is only marked for deallocation; the pending requests
+        // still complete with it.
+        MPI_Type_free(&row_type);
+        return halo;
+    }
+
+    auto guarded(const halo_t& halo) const
+    {
+        // The padded local block, with its guard rows read from the received
+        // ghost data rather than from storage.
+        auto ghost_shape = the_global_shape;
+        ghost_shape[0] = guard;
+
+        auto lower_ghost = make_view(const_cast<ValueType*>(halo.lower_rows.data()), ghost_shape);
+        auto upper_ghost = make_view(const_cast<ValueType*>(halo.upper_rows.data()), ghost_shape);
+        auto upper_start = make_uniform_index<Rank>(0);
+        upper_start[0] = guard + owned_rows();
+
+        return storage
+        | replace_from(make_uniform_index<Rank>(0)).to(index_t<Rank>::from_range(ghost_shape)).with(lower_ghost)
+        | replace_from(upper_start).to(index_t<Rank>::from_range(padded_shape(the_global_shape))).with(upper_ghost);
+    }
+
+    std::size_t radius(shape_t<Rank> result_shape) const
+    {
+        auto padded_rows = owned_rows() + 2 * guard;
+
+        if (result_shape[0] > padded_rows || (padded_rows - result_shape[0]) % 2 != 0)
+        {
+            throw std::logic_error("the mapped array must lose the same number of rows from each side of axis 0");
+        }
+        if (result_shape[0] < owned_rows())
+        {
+            throw std::logic_error("the mapped array reaches further along axis 0 than the guard rows");
+        }
+        return (padded_rows - result_shape[0]) / 2;
+    }
+
+    template<typename ArrayType>
+    auto make_target(const ArrayType& result) const
+    {
+        radius(result.shape());
+        auto shape = result.shape();
+        shape[0] = owned_rows() + 2 * guard;
+        return make_unique_array<std::decay_t<value_type_of<ArrayType>>>(shape);
+    }
+
+    template<typename ArrayType, typename TargetType>
+    void evaluate_rows(const ArrayType& result, std::size_t i0, std::size_t i1, TargetType& target) const
+    {
+        // Rows [i0, i1) of this process's block are rows i + guard - r of the
+        // mapped array, and rows i + guard of the padded target.
+        if (i0 >= i1)
+        {
+            return;
+        }
+        auto offset = guard - radius(result.shape());
+        auto rows = make_access_pattern(result.shape());
+        rows.start[0] = i0 + offset;
+        rows.final[0] = i1 + offset;
+
+        auto target_row_size = target.size() / target.shape(0);
+        detail::evaluate_slab(result.get_provider(), rows, target.data() + (i0 + guard) * target_row_size);
+    }
+
+    template<typename ArrayType>
+    auto with_storage(ArrayType new_storage, bool new_guard_is_valid) const
+    {
+        using new_value_type = std::decay_t<value_type_of<ArrayType>>;
+        auto result = distributed_array_t<Rank, new_value_type>(*this, new_storage.shape());
+
+        result.storage = new_storage;
+        result.guard_is_valid = new_guard_is_valid;
+        return result;
+    }
+
+    template<typename OtherValueType>
+    distributed_array_t(const distributed_array_t<Rank, OtherValueType>& other, shape_t<Rank> padded)
+    : comm(other.comm)
+    , the_global_shape(other.the_global_shape)
+    , guard(other.guard)
+    , periodic(other.periodic)
+    , region(other.region)
+    , lower(other.lower)
+    , upper(other.upper)
+    , storage(make_shared_array<ValueType>(make_uniform_shape<Rank>(0)))
+    {
+        for (std::size_t n = 1; n < Rank; ++n)
+        {
+            the_global_shape[n] = padded[n];
+            region.final[n] = padded[n];
+        }
+    }
+
+    //=========================================================================
+    MPI_Comm comm;
+    shape_t<Rank> the_global_shape;
+    std::size_t guard;
+    bool periodic;
+    access_pattern_t<Rank> region;
+    int lower = MPI_PROC_NULL;
+    int upper = MPI_PROC_NULL;
+    decltype(make_shared_array<ValueType>(shape_t<Rank>())) storage;
+    bool guard_is_valid = false;
+};
+
+
+
+
+/**
+ * @brief      Decompose an array over the processes of a communicator. Each
+ *             process evaluates only its own block of rows of the array.
+ *
+ * @param[in]  comm          The communicator
+ * @param[in]  global_array  The whole array; typically a lazy expression
+ *                           such that each block is cheap to evaluate
+ * @param[in]  guard         The number of guard rows on either side of each
+ *                           block
+ * @param[in]  periodic      Whether axis 0 wraps around
+ *
+ * @tparam     ArrayType     The type of the global array
+ *
+ * @return     A distributed array, whose guard rows are not yet valid
+ */
+template<typename ArrayType>
+auto nd::mpi::distribute(MPI_Comm comm, const ArrayType& global_array, std::size_t guard, bool periodic)
+{
+    using value_type = std::decay_t<value_type_of<ArrayType>>;
+    constexpr std::size_t R = ArrayType::rank;
+
+    auto result = distributed_array_t<R, value_type>(comm, global_array.shape(), guard, periodic);
+    auto target = make_unique_array<value_type>(result.local_with_guard().shape());
+    auto rows = result.local_region();
+
+    detail::evaluate_slab(global_array.get_provider(), rows, target.data() + guard * (global_array.size() / global_array.shape(0)));
+    return result.with_storage(std::move(target).shared(), false);
+}
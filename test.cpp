@@ -107,6 +107,32 @@ TEST_CASE("buffer works as expected", "[buffer]")
         REQUIRE(C[99] == 1.5);
     }
 
+    SECTION("buffer memory is aligned to cache lines")
+    {
+        nd::buffer_t<double> A(100, 1.5);
+        nd::buffer_t<char> B(3, 'a');
+        REQUIRE(reinterpret_cast<std::uintptr_t>(A.data()) % 64 == 0);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(B.data()) % 64 == 0);
+    }
+
+    SECTION("can instantiate an uninitialized buffer")
+    {
+        nd::buffer_t<double> A(100, nd::uninitialized);
+        nd::buffer_t<std::string> B(10, nd::uninitialized);
+        REQUIRE(A.size() == 100);
+        REQUIRE(B.size() == 10);
+        REQUIRE(B[9].empty());
+    }
+
+    SECTION("can hold non-trivial value types")
+    {
+        nd::buffer_t<std::string> A(10, "abc");
+        nd::buffer_t<std::string> B(A.begin(), A.end());
+        A = std::move(B);
+        REQUIRE(A[9] == "abc");
+        REQUIRE(B.empty());
+    }
+
     SECTION("equality operators between buffers work correctly")
     {
         nd::buffer_t<double> A(100, 1.5);   
@@ -136,6 +162,60 @@ TEST_CASE("buffer works as expected", "[buffer]")
     }
 }
 
+namespace
+{
+    // An allocator with state: each one (unless copied) is a distinct arena,
+    // and blocks must be returned to the arena they came from.
+    struct arena_allocator_t
+    {
+        using value_type = double;
+        static inline int num_arenas = 0;
+        static inline int mismatched_deallocations = 0;
+        static inline std::map<double*, int> owners;
+
+        double* allocate(std::size_t n)
+        {
+            auto block = std::allocator<double>().allocate(n);
+            owners[block] = arena;
+            return block;
+        }
+        void deallocate(double* block, std::size_t n)
+        {
+            mismatched_deallocations += owners.at(block) != arena;
+            owners.erase(block);
+            std::allocator<double>().deallocate(block, n);
+        }
+        int arena = ++num_arenas;
+    };
+}
+
+TEST_CASE("move-assigned buffers are released by the allocator that made them", "[buffer]")
+{
+    {
+        auto A = nd::buffer_t<double, arena_allocator_t>(10);
+        auto B = nd::buffer_t<double, arena_allocator_t>(20);
+        A = std::move(B);
+        REQUIRE(A.size() == 20);
+        REQUIRE(B.empty());
+    }
+    REQUIRE(arena_allocator_t::owners.empty());
+    REQUIRE(arena_allocator_t::mismatched_deallocations == 0);
+}
+
+TEST_CASE("memory pool recycles released blocks", "[memory_pool] [buffer]")
+{
+    auto& pool = nd::memory_pool_t::instance();
+    pool.set_enabled(true);
+
+    auto address = nd::buffer_t<double>(1000).data();
+    REQUIRE(pool.cached_bytes() >= 8000);
+    REQUIRE(nd::buffer_t<double>(990).data() == address);
+    REQUIRE(nd::memory_pool_t::size_class(8000) < 10000);
+
+    pool.set_enabled(false);
+    REQUIRE(pool.cached_bytes() == 0);
+}
+
 TEST_CASE("access patterns work OK", "[access_pattern]")
 {
     SECTION("can be constructed with factory")
@@ -524,6 +604,35 @@ TEST_CASE("can get an index array using where, and pass that to read_indexes", "
     REQUIRE(bool(((A | nd::read_indexes(nd::where(A < 5))) < 5) | nd::all()));
 }
 
+TEST_CASE("where evaluates its argument once, and can run in parallel", "[where] [where_offsets]")
+{
+    auto pool = nd::thread_pool_t(2);
+    auto calls = std::make_shared<std::atomic<int>>(0);
+    auto A = nd::index_array(40, 9) | nd::transform([calls] (auto i) { ++*calls; return (i[0] * 9 + i[1]) % 7 == 3; });
+
+    auto I = nd::where(A);
+    REQUIRE(*calls == 360);
+    REQUIRE(I.size() == 51);
+    REQUIRE(I(0) == nd::make_index(0, 3));
+    REQUIRE(I(1) == nd::make_index(1, 1));
+
+    auto J = nd::where(A, pool);
+    auto K = nd::where_offsets(A);
+    auto L = nd::where_offsets(A, pool);
+    REQUIRE(J.size() == I.size());
+    REQUIRE(K.size() == I.size());
+    REQUIRE(L.size() == I.size());
+
+    for (std::size_t n = 0; n < I.size(); ++n)
+    {
+        REQUIRE(J(n) == I(n));
+        REQUIRE(K(n) == I(n)[0] * 9 + I(n)[1]);
+        REQUIRE(L(n) == K(n));
+    }
+    REQUIRE(nd::where(nd::zeros(0, 4)).size() == 0);
+    REQUIRE(nd::where_offsets(nd::zeros(5, 4), pool).size() == 0);
+}
+
 TEST_CASE("can get the sum of a 3D array on each axis", "[collect]")
 {
     auto A = nd::ones(10, 20, 30);
@@ -560,3 +669,986 @@ TEST_CASE("can shift an array", "[shift]")
     REQUIRE((A | nd::shift_by(+2).along_axis(0) | nd::read_index(2, 0)) == nd::make_index(0, 0));
     REQUIRE((A | nd::shift_by(+2).along_axis(1) | nd::read_index(0, 2)) == nd::make_index(0, 0));
 }
+
+TEST_CASE("shapes can be partitioned at runtime", "[partition_shape]")
+{
+    auto regions = nd::partition_shape(nd::make_shape(10, 4), 4);
+    REQUIRE(regions.size() == 4);
+    REQUIRE(regions[0].shape() == nd::make_shape(3, 4));
+    REQUIRE(regions[3].shape() == nd::make_shape(2, 4));
+    REQUIRE(regions[3].final == nd::make_index(10, 4));
+    REQUIRE(nd::partition_shape(nd::make_shape(3, 4), 8).size() == 3);
+    REQUIRE(nd::partition_shape(nd::make_shape(0, 4), 8).empty());
+}
+
+TEST_CASE("thread pool executes every task exactly once", "[thread_pool]")
+{
+    auto pool = nd::thread_pool_t(4);
+    auto counts = std::vector<std::atomic<int>>(100);
+
+    pool.parallel_for(counts.size(), [&] (std::size_t n) { ++counts[n]; });
+    REQUIRE(std::all_of(counts.begin(), counts.end(), [] (auto& c) { return c == 1; }));
+    REQUIRE_THROWS(pool.parallel_for(10, [] (std::size_t n) { if (n == 5) throw std::runtime_error("task failed"); }));
+
+    SECTION("tasks may themselves run parallel loops on the same pool")
+    {
+        auto total = std::atomic<int>(0);
+        pool.parallel_for(8, [&] (std::size_t) { pool.parallel_for(8, [&] (std::size_t) { ++total; }); });
+        REQUIRE(total == 64);
+    }
+}
+
+TEST_CASE("arrays can be evaluated in parallel", "[to_shared_parallel] [evaluate_on]")
+{
+    auto pool = nd::thread_pool_t(3);
+    auto A = nd::index_array(17, 5) | nd::transform([] (auto i) { return double(i[0] * 5 + i[1]); });
+    auto B = A | nd::to_shared_parallel(pool);
+    auto serial_pool = nd::thread_pool_t(0);
+    auto C = A | nd::evaluate_on(serial_pool);
+    REQUIRE(B.shape() == A.shape());
+    REQUIRE(bool((A == B) | nd::all()));
+    REQUIRE(bool((A == C) | nd::all()));
+    REQUIRE(bool((A == (A | nd::to_unique_parallel(pool)).shared()) | nd::all()));
+}
+
+TEST_CASE("arrays can be reduced in parallel", "[sum_on] [all_on] [any_on] [reduce_on]")
+{
+    auto pool = nd::thread_pool_t(3);
+    auto A = nd::index_array(37, 11) | nd::transform([] (auto i) { return int(i[0] + i[1]); });
+
+    REQUIRE((A | nd::sum_on(pool)) == (A | nd::sum()));
+    REQUIRE((nd::ones(10, 10) | nd::sum_on(pool)) == 100);
+    REQUIRE(((nd::ones(10, 10) == nd::ones(10, 10)) | nd::sum_on(pool)) == 100);
+    REQUIRE((A | nd::reduce_on(pool, [] (int a, int b) { return std::max(a, b); }, 0)) == 46);
+    REQUIRE((nd::zeros(0, 4) | nd::reduce_on(pool, std::plus<>(), 7)) == 7);
+    REQUIRE((A >= 0 | nd::all_on(pool)));
+    REQUIRE_FALSE((A > 0 | nd::all_on(pool)));
+    REQUIRE((A == 46 | nd::any_on(pool)));
+    REQUIRE_FALSE((A > 46 | nd::any_on(pool)));
+
+    SECTION("floating-point sums are compensated")
+    {
+        auto B = nd::ones<double>(100000) | nd::transform([] (auto x) { return 0.1 * x; });
+        REQUIRE(std::abs((B | nd::sum_on(pool)) - 10000.0) < 1e-9);
+    }
+}
+
+TEST_CASE("memory-backed arrays are evaluated by a linear copy", "[to_shared] [evaluate_on]")
+{
+    auto pool = nd::thread_pool_t(2);
+    auto A = nd::make_unique_array<double>(9, 4, 3);
+
+    for (auto index : A.indexes())
+    {
+        A(index) = index[0] * 100 + index[1] * 10 + index[2];
+    }
+    auto B = std::move(A).shared();
+    auto C = B | nd::to_shared();
+    auto D = B | nd::to_shared_parallel(pool);
+    auto E = nd::zip_arrays(B, B) | nd::to_shared();
+
+    REQUIRE(C.data() != B.data());
+    REQUIRE(D.data() != B.data());
+    REQUIRE(bool((B == C) | nd::all()));
+    REQUIRE(bool((B == D) | nd::all()));
+    REQUIRE(E(8, 3, 2) == std::make_tuple(832.0, 832.0));
+}
+
+TEST_CASE("providers can evaluate rows along the last axis", "[evaluate_row]")
+{
+    auto A = nd::index_array(3, 700) | nd::transform([] (auto i) { return double(i[0] * 1000 + i[1]); }) | nd::to_shared();
+    auto row = std::vector<double>(700);
+
+    SECTION("shared and uniform providers")
+    {
+        A.get_provider().evaluate_row(nd::make_index(1, 0), row.data(), 700);
+        REQUIRE(row[0] == 1000.0);
+        REQUIRE(row[699] == 1699.0);
+        nd::ones<double>(3, 700).get_provider().evaluate_row(nd::make_index(0, 0), row.data(), 700);
+        REQUIRE(std::all_of(row.begin(), row.end(), [] (auto x) { return x == 1.0; }));
+    }
+    SECTION("transform and binary operations of providers")
+    {
+        auto B = (A | nd::transform([] (auto x) { return 2 * x; })) + nd::ones(3, 700);
+        B.get_provider().evaluate_row(nd::make_index(2, 100), row.data(), 600);
+        REQUIRE(row[0] == 2 * 2100.0 + 1);
+        REQUIRE(row[599] == 2 * 2699.0 + 1);
+
+        auto C = B | nd::to_shared();
+        REQUIRE(bool((B == C) | nd::all()));
+        REQUIRE((B | nd::sum()) == (B | nd::to_shared() | nd::sum()));
+    }
+}
+
+TEST_CASE("SIMD packs support element-wise arithmetic", "[simd_pack]")
+{
+    using pack_type = nd::simd_pack_t<double, nd::simd_width<double>>;
+    double a[pack_type::width];
+    double b[pack_type::width];
+
+    for (std::size_t n = 0; n < pack_type::width; ++n)
+    {
+        a[n] = double(n);
+    }
+    (2 * pack_type::load(a) * pack_type::load(a) + 1.0 - pack_type::broadcast(3.0) / 3).store(b);
+
+    for (std::size_t n = 0; n < pack_type::width; ++n)
+    {
+        REQUIRE(b[n] == 2.0 * n * n);
+        REQUIRE((-pack_type::load(a))[n] == -double(n));
+    }
+}
+
+TEST_CASE("vectorized functions give the same results as scalar ones", "[simd_pack] [vectorized] [transform]")
+{
+    auto A = nd::index_array(5, 301) | nd::transform([] (auto i) { return 0.5 * i[0] + i[1]; }) | nd::to_shared();
+    auto B = A | nd::transform(nd::vectorized([] (auto x) { return x * x - 2.0 * x; }));
+    auto C = (A * A - A * 2.0) / (A + 1.0);
+    auto B_scalar = A | nd::transform([] (auto x) { return x * x - 2.0 * x; });
+    auto C_scalar = nd::make_array([A] (auto i) { return (A(i) * A(i) - A(i) * 2.0) / (A(i) + 1.0); }, A.shape());
+
+    REQUIRE(bool(((B | nd::to_shared()) == B_scalar) | nd::all()));
+    REQUIRE(bool(((C | nd::to_shared()) == C_scalar) | nd::all()));
+}
+
+TEST_CASE("vectorized negation flips the sign of zero", "[simd_pack] [vectorized] [transform]")
+{
+    auto A = nd::zeros<double>(67) | nd::to_shared();
+    auto B = A | nd::transform(std::negate<>()) | nd::to_shared();
+    auto C = A | nd::select_from(2).to(66) | nd::transform(std::negate<>()) | nd::to_shared();
+
+    REQUIRE(bool((B | nd::transform([] (double x) { return std::signbit(x); })) | nd::all()));
+    REQUIRE(bool((C | nd::transform([] (double x) { return std::signbit(x); })) | nd::all()));
+}
+
+TEST_CASE("arrays can be saved to and loaded from .npy files", "[npy] [mmap_provider]")
+{
+    auto filename = std::string("test_npy_roundtrip.npy");
+    auto A = nd::index_array(4, 3, 5) | nd::transform([] (auto i) { return i[0] * 1.5 + i[1] * 10 + i[2]; });
+    auto B = A | nd::to_shared();
+
+    SECTION("lazy arrays")
+    {
+        nd::save_npy(filename, A);
+        REQUIRE(bool((nd::load_npy<double, 3>(filename) == B) | nd::all()));
+    }
+    SECTION("memory-backed arrays")
+    {
+        nd::save_npy(filename, B);
+        auto C = nd::load_npy<double, 3>(filename);
+        auto D = nd::map_npy<double, 3>(filename);
+        REQUIRE(C.shape() == B.shape());
+        REQUIRE(bool((C == B) | nd::all()));
+        REQUIRE(bool((D == B) | nd::all()));
+        REQUIRE(bool(((D | nd::reshape(60) | nd::to_shared()) == (B | nd::reshape(60))) | nd::all()));
+        REQUIRE(reinterpret_cast<std::uintptr_t>(D.data()) % 64 == 0);
+    }
+    SECTION("lazy bool arrays")
+    {
+        nd::save_npy(filename, A > 20.0);
+        auto M = nd::load_npy<bool, 3>(filename);
+        REQUIRE(M.shape() == A.shape());
+        REQUIRE(bool((M == (A > 20.0)) | nd::all()));
+        REQUIRE(bool(M(3, 2, 4)));
+        REQUIRE(! bool(M(0, 0, 0)));
+    }
+    SECTION("mismatched value types and ranks are rejected")
+    {
+        nd::save_npy(filename, nd::ones<int>(7));
+        REQUIRE((nd::load_npy<int, 1>(filename) | nd::sum()) == 7);
+        REQUIRE_THROWS(nd::load_npy<double, 1>(filename));
+        REQUIRE_THROWS(nd::load_npy<int, 2>(filename));
+        REQUIRE_THROWS(nd::load_npy<int, 1>("no_such_file.npy"));
+    }
+    SECTION("truncated shapes are rejected")
+    {
+        for (auto dict : {std::string("{'descr': '<f8', 'fortran_order': False, 'shape': (3, "), std::string("{'descr': '<f8', 'fortran_order': False, 'shape': (3")})
+        {
+            dict.resize(63, ' ');
+            dict += '\n';
+            auto stream = std::ofstream(filename, std::ios::binary);
+            stream.write("\x93NUMPY\x01\x00", 8);
+            stream.put(char(dict.size()));
+            stream.put(0);
+            stream << dict;
+            stream.close();
+            REQUIRE_THROWS_WITH((nd::load_npy<double, 1>(filename)), "malformed .npy shape");
+        }
+    }
+    std::remove(filename.data());
+}
+
+TEST_CASE("arrays can view external memory without copying it", "[view_provider] [make_view]")
+{
+    auto memory = std::vector<double>(24);
+    std::iota(memory.begin(), memory.end(), 0.0);
+
+    SECTION("row-major views read and write the memory in place")
+    {
+        auto A = nd::make_view(memory.data(), nd::make_shape(4, 6));
+        A(1, 2) = -1.0;
+        REQUIRE(memory[8] == -1.0);
+        REQUIRE(A.data() == memory.data());
+        REQUIRE((A | nd::reshape(2, 12) | nd::read_index(1, 0)) == 12.0);
+        REQUIRE(bool(((A | nd::to_shared()) == A) | nd::all()));
+    }
+    SECTION("read-only views accept pointers to const")
+    {
+        const double* data = memory.data();
+        auto A = nd::make_view(data, nd::make_shape(24));
+        static_assert(std::is_same<decltype(A)::value_type, double>::value);
+        static_assert(std::is_same<decltype(A(0)), const double&>::value);
+        REQUIRE((A | nd::sum()) == 276.0);
+    }
+    SECTION("column-major and padded views")
+    {
+        auto shape = nd::make_shape(4, 6);
+        auto A = nd::make_view(memory.data(), shape, nd::make_strides_column_major(shape));
+        auto B = nd::make_view(memory.data(), nd::make_shape(3, 5), nd::memory_strides_t<2>{8, 1});
+        REQUIRE(A(1, 2) == 9.0);
+        REQUIRE(B(2, 4) == 20.0);
+        REQUIRE((A | nd::to_shared() | nd::read_index(3, 5)) == 23.0);
+        REQUIRE((B | nd::to_shared() | nd::read_index(2, 1)) == 17.0);
+        REQUIRE_THROWS(A | nd::reshape(24));
+    }
+}
+
+TEST_CASE("slices of memory-backed arrays are strided views of the same memory", "[select] [select_axis] [freeze_axis] [shift]")
+{
+    auto A = nd::index_array(6, 8) | nd::transform([] (auto i) { return double(i[0] * 8 + i[1]); }) | nd::to_shared();
+    auto L = nd::index_array(6, 8) | nd::transform([] (auto i) { return double(i[0] * 8 + i[1]); });
+
+    SECTION("select keeps the buffer and matches the lazy result")
+    {
+        auto S = A | nd::select(nd::make_access_pattern(5, 8).with_start(1, 2).with_jumps(2, 3));
+        static_assert(std::is_same<decltype(S)::provider_type, decltype(A)::provider_type>::value);
+        REQUIRE(S.data() == A.data() + 10);
+        REQUIRE(S.shape() == nd::make_shape(2, 2));
+        REQUIRE(bool((S == (L | nd::select(nd::make_access_pattern(5, 8).with_start(1, 2).with_jumps(2, 3)))) | nd::all()));
+        REQUIRE_FALSE(S.get_provider().contiguous());
+        REQUIRE_THROWS(S | nd::reshape(4));
+    }
+    SECTION("contiguous row slices can be reshaped and evaluated by a linear copy")
+    {
+        auto S = A | nd::select_axis(0).from(2).to(4);
+        REQUIRE(S.data() == A.data() + 16);
+        REQUIRE(S.get_provider().contiguous());
+        REQUIRE((S | nd::reshape(16) | nd::read_index(15)) == 31.0);
+        REQUIRE(bool(((S | nd::to_shared()) == (L | nd::select_axis(0).from(2).to(4))) | nd::all()));
+    }
+    SECTION("freeze_axis and shift give the same values as the lazy operators")
+    {
+        REQUIRE(bool(((A | nd::freeze_axis(1).at_index(3)) == (L | nd::freeze_axis(1).at_index(3))) | nd::all()));
+        REQUIRE(bool(((A | nd::freeze_axis(0).at_index(5)) == (L | nd::freeze_axis(0).at_index(5))) | nd::all()));
+        REQUIRE(bool(((A | nd::shift_by(-2).along_axis(1)) == (L | nd::shift_by(-2).along_axis(1))) | nd::all()));
+        REQUIRE((A | nd::shift_by(+2).along_axis(0) | nd::read_index(2, 1)) == 1.0);
+        REQUIRE((A | nd::shift_by(+2).along_axis(0)).data() == nullptr);
+        REQUIRE_FALSE((A | nd::shift_by(+2).along_axis(0)).get_provider().contiguous());
+        REQUIRE((A | nd::freeze_axis(0).at_index(5)).data() == A.data() + 40);
+    }
+    SECTION("views of external memory are sliced the same way")
+    {
+        auto memory = std::vector<double>(48);
+        auto V = nd::make_view(memory.data(), nd::make_shape(6, 8));
+        auto S = V | nd::select_axis(1).from(4).to(8);
+        S(0, 0) = 1.0;
+        REQUIRE(memory[4] == 1.0);
+    }
+}
+
+TEST_CASE("access patterns can be split into tiles", "[access_pattern] [tiled]")
+{
+    SECTION("tiles generate every index exactly once")
+    {
+        auto pattern = nd::make_access_pattern(7, 10, 5);
+        auto tiles = pattern.tiled(nd::make_shape(3, 4, 5));
+        auto visited = nd::make_unique_array<int>(7, 10, 5);
+
+        REQUIRE(tiles.size() == 9);
+        REQUIRE(tiles[1].start == nd::make_index(0, 4, 0));
+        REQUIRE(tiles[8].shape() == nd::make_shape(1, 2, 5));
+
+        for (const auto& tile : tiles)
+        {
+            for (const auto& index : tile)
+            {
+                visited(index) += 1;
+            }
+        }
+        REQUIRE(bool((visited.shared() == 1) | nd::all()));
+    }
+    SECTION("tiles of a jumping pattern keep its jumps")
+    {
+        auto pattern = nd::make_access_pattern(10).with_jumps(2);
+        auto tiles = pattern.tiled(nd::make_shape(2));
+        REQUIRE(tiles.size() == 3);
+        REQUIRE(tiles[1].start == nd::make_index(4));
+        REQUIRE(tiles[2].final == nd::make_index(10));
+        REQUIRE(nd::distance(tiles[2]) == 1);
+    }
+    SECTION("empty patterns and empty tiles")
+    {
+        REQUIRE(nd::make_access_pattern(0, 4).tiled(nd::make_shape(2, 2)).empty());
+        REQUIRE_THROWS(nd::make_access_pattern(4, 4).tiled(nd::make_shape(0, 2)));
+    }
+}
+
+TEST_CASE("arrays can be evaluated and summed one tile at a time", "[to_shared] [to_shared_parallel] [sum] [sum_on]")
+{
+    auto pool = nd::thread_pool_t(2);
+    auto A = nd::index_array(33, 17) | nd::transform([] (auto i) { return double(i[0] * 17 + i[1]); });
+    auto tile = nd::make_shape(8, 8);
+
+    REQUIRE(bool(((A | nd::to_shared(tile)) == (A | nd::to_shared())) | nd::all()));
+    REQUIRE(bool(((A | nd::to_unique_parallel(pool, tile) | nd::to_shared()) == (A | nd::to_shared())) | nd::all()));
+    REQUIRE(bool(((A | nd::to_shared(tile) | nd::select_axis(1).from(3).to(9) | nd::to_shared(tile)) == (A | nd::select_axis(1).from(3).to(9))) | nd::all()));
+    REQUIRE((A | nd::sum(tile)) == (A | nd::sum()));
+    REQUIRE((A | nd::sum_on(pool, tile)) == (A | nd::sum()));
+}
+
+TEST_CASE("axis sums agree with the generic axis reduction", "[collect] [sum]")
+{
+    auto pool = nd::thread_pool_t(2);
+    auto generic_sum = [] (auto&& array) { return array | nd::sum(); };
+    auto L = nd::index_array(5, 300, 7) | nd::transform([] (auto i) { return 0.1 * double(i[0] + 3 * i[1] + 7 * i[2]); });
+    auto A = L | nd::to_shared();
+
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        auto expected = L | nd::collect(generic_sum).along_axis(axis) | nd::to_shared();
+        REQUIRE(bool(((A | nd::collect(nd::sum()).along_axis(axis)) == expected) | nd::all()));
+        REQUIRE(bool(((L | nd::collect(nd::sum()).along_axis(axis) | nd::to_shared_parallel(pool)) == expected) | nd::all()));
+    }
+    auto B = nd::index_array(4, 6) | nd::transform([] (auto i) { return i[0] <= i[1]; });
+    REQUIRE((B | nd::collect(nd::sum()).along_axis(0) | nd::read_index(5)) == 4ul);
+    REQUIRE((B | nd::collect(nd::sum()).along_axis(1) | nd::read_index(3)) == 3ul);
+}
+
+TEST_CASE("the generic axis reduction does not copy a lazy operand per element", "[collect]")
+{
+    struct counted_t
+    {
+        counted_t(std::shared_ptr<int> copies) : copies(copies) {}
+        counted_t(const counted_t& other) : copies(other.copies) { ++*copies; }
+        double operator()(nd::index_t<2> i) const { return double(i[0] + i[1]); }
+        std::shared_ptr<int> copies;
+    };
+    auto copies = std::make_shared<int>(0);
+    auto L = nd::index_array(50, 30) | nd::transform(counted_t(copies));
+    auto R = L | nd::collect([] (auto&& line) { return line | nd::sum(); }).along_axis(1);
+
+    *copies = 0;
+    auto S = R | nd::to_shared();
+
+    REQUIRE(S(7) == 7 * 30 + 435);
+    REQUIRE(*copies < 50);
+}
+
+TEST_CASE("a generic axis reduction may return a lazy array of its line", "[collect]")
+{
+    auto A = nd::index_array(4, 6) | nd::transform([] (auto i) { return double(10 * i[0] + i[1]); }) | nd::to_shared();
+    auto L = A | nd::transform([] (double x) { return x; });
+    auto row = [&L] (std::size_t i)
+    {
+        auto R = L | nd::collect([] (auto line) { return line | nd::select_from(1).to(3); }).along_axis(1);
+        return R(i);
+    };
+    auto S = row(2);
+
+    REQUIRE(S.shape() == nd::make_shape(2));
+    REQUIRE(S(0) == 21.0);
+    REQUIRE(S(1) == 22.0);
+    REQUIRE((row(3) | nd::read_index(1)) == 32.0);
+}
+
+TEST_CASE("cached arrays are evaluated once and shared by all their copies", "[cache]")
+{
+    auto calls = std::make_shared<std::atomic<int>>(0);
+    auto expensive = [calls] (auto i) { ++*calls; return double(i[0] * 10 + i[1]); };
+
+    SECTION("the whole array is evaluated on first access")
+    {
+        auto X = nd::index_array(6, 10) | nd::transform(expensive) | nd::cache();
+        REQUIRE(*calls == 0);
+        auto Y = (X | nd::select_axis(0).from(0).to(5)) + (X | nd::shift_by(-1).along_axis(0));
+        auto Z = Y | nd::to_shared();
+        REQUIRE(*calls == 60);
+        REQUIRE(Z(0, 3) == 3.0 + 13.0);
+        REQUIRE((X | nd::sum()) == 1770.0);
+        REQUIRE(*calls == 60);
+    }
+    SECTION("tiles are evaluated as they are first read")
+    {
+        auto X = nd::index_array(6, 10) | nd::transform(expensive) | nd::cache(nd::make_shape(4, 4));
+        REQUIRE(X(1, 5) == 15.0);
+        REQUIRE(*calls == 16);
+        REQUIRE(X(3, 6) == 36.0);
+        REQUIRE(*calls == 16);
+        REQUIRE(bool(((X | nd::select_axis(1).from(2).to(9) | nd::to_shared()) == (nd::index_array(6, 10) | nd::transform(expensive) | nd::select_axis(1).from(2).to(9))) | nd::all()));
+    }
+    SECTION("concurrent readers see a single evaluation")
+    {
+        auto pool = nd::thread_pool_t(3);
+        auto X = nd::index_array(64, 8) | nd::transform(expensive) | nd::cache(nd::make_shape(8, 8));
+        auto Y = X | nd::to_shared_parallel(pool);
+        REQUIRE(*calls == 512);
+        REQUIRE((Y | nd::sum()) == (X | nd::sum()));
+    }
+}
+
+TEST_CASE("stencils agree with sums of shifted arrays", "[stencil] [shift]")
+{
+    auto pool = nd::thread_pool_t(2);
+    auto A = nd::index_array(12, 300) | nd::transform([] (auto i) { return double(i[0] * i[0] + 3 * i[1]); }) | nd::to_shared();
+    auto K = nd::make_unique_array<double>(3, 3);
+    K(0, 1) = K(1, 0) = K(1, 2) = K(2, 1) = 1.0;
+    K(1, 1) = -4.0;
+    auto kernel = std::move(K).shared();
+
+    auto inner = [] (auto array) { return array | nd::select(nd::make_access_pattern(11, 299).with_start(1, 1)); };
+    auto laplacian = (A | nd::select_axis(0).from(0).to(10) | nd::select_axis(1).from(1).to(299))
+    + (A | nd::select_axis(0).from(2).to(12) | nd::select_axis(1).from(1).to(299))
+    + (A | nd::select_axis(0).from(1).to(11) | nd::select_axis(1).from(0).to(298))
+    + (A | nd::select_axis(0).from(1).to(11) | nd::select_axis(1).from(2).to(300))
+    - (inner(A) | nd::transform([] (double x) { return 4.0 * x; }));
+
+    auto L1 = A | nd::stencil(kernel);
+    auto L2 = (A | nd::transform([] (double x) { return x; })) | nd::stencil(kernel);
+    REQUIRE(L1.shape() == nd::make_shape(10, 298));
+    REQUIRE(L1(3, 4) == 2.0);
+    REQUIRE(bool(((L1 | nd::to_shared()) == laplacian) | nd::all()));
+    REQUIRE(bool(((L2 | nd::to_shared_parallel(pool, nd::make_shape(4, 64))) == laplacian) | nd::all()));
+    REQUIRE((nd::ones(10, 10) | nd::stencil(nd::ones<double>(1, 2))).shape() == (nd::ones(10, 10) | nd::shift_by(1).along_axis(1)).shape());
+    REQUIRE_THROWS(nd::ones(2, 2) | nd::stencil(kernel));
+}
+
+TEST_CASE("provider traits describe arrays and providers", "[traits]")
+{
+    auto A = nd::make_shared_array<double>(4, 5);
+    auto U = nd::ones<double>(4, 5);
+    auto T = A | nd::transform([] (double x) { return x + 1.0; });
+    auto M = nd::index_array(4, 5);
+    auto memory = std::vector<double>(20);
+
+    static_assert(nd::is_memory_backed_v<decltype(A)>);
+    static_assert(nd::is_memory_backed_v<decltype(A.get_provider())>);
+    static_assert(nd::is_memory_backed_v<decltype(nd::make_view(memory.data(), nd::make_shape(20)))>);
+    static_assert(nd::is_contiguous_v<nd::unique_provider_t<2, double>>);
+    static_assert(! nd::is_contiguous_v<decltype(A)>);
+    static_assert(! nd::is_memory_backed_v<decltype(T)>);
+    static_assert(nd::is_uniform_v<decltype(U)>);
+    static_assert(! nd::is_uniform_v<decltype(A)>);
+    static_assert(nd::is_elementwise_v<decltype(T)>);
+    static_assert(nd::is_elementwise_v<decltype(A + U)>);
+    static_assert(! nd::is_elementwise_v<decltype(M)>);
+    static_assert(nd::has_evaluate_row_v<decltype(T)>);
+    static_assert(! nd::has_evaluate_row_v<decltype(M)>);
+
+    REQUIRE(bool(((T + 2.0 | nd::to_shared()) == 3.0) | nd::all()));
+    REQUIRE(bool(((T * 2.0 | nd::to_shared()) == 2.0) | nd::all()));
+}
+
+TEST_CASE("without NDARRAY_ENABLE_STATS the instrumentation counters stay zero", "[stats]")
+{
+    auto A = nd::index_array(20, 30) | nd::transform([] (auto i) { return double(i[0] + i[1]); });
+
+    nd::reset_stats();
+    auto B = (A + A) | nd::to_shared();
+    auto stats = nd::stats();
+
+    REQUIRE(B(3, 4) == 14.0);
+    REQUIRE(stats.evaluations == 0);
+    REQUIRE(stats.allocations == 0);
+    REQUIRE(stats.element_accesses["transform"] == 0);
+    REQUIRE(stats.element_accesses["binary_op"] == 0);
+}
+
+TEST_CASE("operators move temporary operands rather than copying them", "[transform] [binary_op] [concat] [zip]")
+{
+    struct counted_mapping_t
+    {
+        counted_mapping_t(std::size_t* copies) : copies(copies) {}
+        counted_mapping_t(const counted_mapping_t& other) : copies(other.copies) { ++*copies; }
+        counted_mapping_t(counted_mapping_t&& other) = default;
+        int operator()(nd::index_t<1> index) const { return int(index[0]); }
+        std::size_t* copies;
+    };
+    auto copies = std::size_t(0);
+    auto make_counted = [&copies] () { return nd::make_array(counted_mapping_t(&copies), nd::make_shape(10)); };
+
+    auto A = (make_counted() | nd::transform([] (int x) { return 2 * x; })) + 1;
+    auto B = (std::move(A) + make_counted()) | nd::concat(make_counted()) | nd::select_axis(0).from(2).to(20) | nd::shift_by(1);
+    auto C = nd::zip_arrays(std::move(B), make_counted() | nd::select_axis(0).to(17) | nd::replace_from(0).to(2).with(make_counted() | nd::select_axis(0).to(2)));
+    REQUIRE(copies == 0);
+    REQUIRE(std::get<0>(C(1)) == 2 * 2 + 1 + 2);
+    REQUIRE(std::get<1>(C(1)) == 1);
+    REQUIRE(std::get<1>(C(5)) == 5);
+
+    auto D = make_counted();
+    auto E = D | nd::transform([] (int x) { return x; });
+    REQUIRE(copies == 1);
+    REQUIRE(E(3) == 3);
+}
+
+TEST_CASE("arrays can be evaluated into existing unique arrays", "[evaluate_into] [double_buffer]")
+{
+    nd::thread_pool_t pool(3);
+    auto A = nd::index_array(20, 30) | nd::transform([] (auto i) { return double(i[0] * 30 + i[1]); });
+    auto B = nd::make_unique_array<double>(20, 30);
+    auto C = nd::make_unique_array<double>(20, 30);
+    auto D = nd::make_unique_array<double>(20, 31);
+
+    nd::evaluate_into(B, A);
+    nd::evaluate_into(C, A * 2.0, pool);
+    REQUIRE(B(7, 11) == A(7, 11));
+    REQUIRE(C(7, 11) == 2 * A(7, 11));
+    REQUIRE_THROWS_AS(nd::evaluate_into(D, A), std::logic_error);
+
+    auto state = nd::double_buffer_t<2, double>(A);
+    auto update = [] (auto S) { return S | nd::transform([] (double x) { return 0.5 * x + 1.0; }); };
+
+    for (int n = 0; n < 10; ++n)
+    {
+        if (n % 2) state.step(update);
+        else       state.step(update, pool);
+    }
+
+    auto expected = A | nd::to_shared();
+
+    for (int n = 0; n < 10; ++n)
+    {
+        expected = update(expected) | nd::to_shared();
+    }
+    REQUIRE(state.shape() == A.shape());
+    REQUIRE((state.current() == expected | nd::all()));
+}
+
+TEST_CASE("moving a unique array to a shared one transfers its buffer", "[unique_array]")
+{
+    auto A = nd::make_unique_array<double>(10, 20);
+    auto data = A.data();
+    auto B = std::move(A).shared();
+    REQUIRE(B.data() == data);
+}
+
+TEST_CASE("shapes can be partitioned into tiles over several axes", "[partition_shape] [partition_tiles]")
+{
+    auto static_regions = nd::partition_shape<4>(nd::make_shape(10, 4));
+    REQUIRE(static_regions[0].shape() == nd::make_shape(3, 4));
+    REQUIRE(static_regions[1].shape() == nd::make_shape(3, 4));
+    REQUIRE(static_regions[3].shape() == nd::make_shape(2, 4));
+    REQUIRE(static_regions[3].final == nd::make_index(10, 4));
+
+    auto shape = nd::make_shape(3, 40, 7);
+    auto tiles = nd::partition_tiles(shape, 32);
+    auto visits = std::vector<int>(shape.volume());
+    auto strides = nd::make_strides_row_major(shape);
+
+    REQUIRE(tiles.size() == 33);
+    REQUIRE(tiles[0].shape() == nd::make_shape(1, 4, 7));
+    REQUIRE(tiles.back().final == nd::make_index(3, 40, 7));
+    REQUIRE(nd::partition_tiles(nd::make_shape(100, 7), 8).size() == 8);
+    REQUIRE(nd::partition_tiles(nd::make_shape(2, 2), 8).size() == 4);
+    REQUIRE(nd::partition_tiles(nd::make_shape(0, 4), 8).empty());
+
+    for (const auto& tile : tiles)
+    {
+        for (const auto& index : tile)
+        {
+            ++visits[strides.compute_offset(index)];
+        }
+    }
+    REQUIRE(std::all_of(visits.begin(), visits.end(), [] (int v) { return v == 1; }));
+
+    SECTION("arrays shorter on axis 0 than the pool are evaluated and reduced over tiles")
+    {
+        auto pool = nd::thread_pool_t(4);
+        auto A = nd::index_array(shape) | nd::transform([] (auto i) { return double(i[0] * 280 + i[1] * 7 + i[2]); });
+        auto B = nd::make_unique_array<double>(shape);
+        nd::evaluate_into(B, A, pool);
+
+        REQUIRE(bool((A == (A | nd::to_shared_parallel(pool))) | nd::all()));
+        REQUIRE(bool((A == (A | nd::to_shared_parallel(pool, nd::make_shape(2, 3, 2)))) | nd::all()));
+        REQUIRE(bool((A == std::move(B).shared()) | nd::all()));
+        REQUIRE((A | nd::sum_on(pool)) == (A | nd::sum()));
+        REQUIRE((A | nd::sum_on(pool, nd::make_shape(2, 3, 2))) == (A | nd::sum()));
+        REQUIRE((A < 840 | nd::all_on(pool)));
+        REQUIRE((A == 839 | nd::any_on(pool)));
+    }
+}
+
+TEST_CASE("arrays can be evaluated asynchronously, and further work chained on them", "[evaluate_async] [then] [thread_pool]")
+{
+    auto pool = nd::thread_pool_t(2);
+    auto A = nd::index_array(40, 30) | nd::transform([] (auto i) { return double(i[0] + i[1]); });
+    auto step = [] (auto U) { return U | nd::transform([] (double x) { return 2.0 * x; }) | nd::to_shared(); };
+
+    REQUIRE(pool.submit([] { return 42; }).get() == 42);
+    REQUIRE_THROWS_AS(pool.submit([] { throw std::runtime_error("task failed"); }).get(), std::runtime_error);
+
+    auto U0 = nd::evaluate_async(A, pool);
+    auto U1 = nd::then(U0, pool, step);
+    auto U2 = nd::then(U1, pool, step);
+    auto total = nd::then(U0, pool, [] (auto U) { return U | nd::sum(); });
+    auto done = nd::then(nd::then(U2, pool, [] (auto) {}), pool, [] { return true; });
+
+    REQUIRE(bool((pool.wait(U0) == A) | nd::all()));
+    REQUIRE(bool((pool.wait(U2) == (A | nd::transform([] (double x) { return 4.0 * x; }))) | nd::all()));
+    REQUIRE(pool.wait(total) == (A | nd::sum()));
+    REQUIRE(pool.wait(done));
+
+    SECTION("tasks waiting on other tasks do not deadlock a small pool")
+    {
+        auto small_pool = nd::thread_pool_t(1);
+        auto V0 = nd::evaluate_async(A, small_pool);
+        auto V = nd::then(V0, small_pool, [&] (auto U)
+        {
+            auto W = nd::then(nd::evaluate_async(U, small_pool), small_pool, step);
+            return small_pool.wait(W);
+        });
+        REQUIRE(bool((V.get() == (A | nd::transform([] (double x) { return 2.0 * x; }))) | nd::all()));
+    }
+
+    SECTION("a task waiting on a continuation runs it, even if another thread ran its dependency")
+    {
+        // The worker runs task A, which queues B and then waits on a
+        // continuation C of B. The main thread takes B off the queue, so C is
+        // only released once A is already waiting with nothing to run.
+        auto small_pool = nd::thread_pool_t(1);
+        auto b_started = std::atomic<bool>(false);
+        auto handoff = std::promise<std::shared_future<void>>();
+
+        auto fA = small_pool.submit([&]
+        {
+            auto fB = small_pool.submit([&]
+            {
+                b_started = true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }).share();
+            handoff.set_value(fB);
+
+            while (! b_started)
+            {
+                std::this_thread::yield();
+            }
+            auto fC = nd::then(fB, small_pool, [] { return 7; });
+            return small_pool.wait(fC);
+        });
+        auto fB = handoff.get_future().get();
+        small_pool.wait(fB);
+
+        REQUIRE(fA.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+        REQUIRE(fA.get() == 7);
+    }
+
+    SECTION("a pool without workers evaluates immediately")
+    {
+        auto serial_pool = nd::thread_pool_t(0);
+        auto V = nd::evaluate_async(A, serial_pool);
+        REQUIRE(V.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    }
+}
+
+TEST_CASE("arrays can be evaluated a chunk of rows at a time", "[evaluate_in_chunks]")
+{
+    auto pool = nd::thread_pool_t(3);
+    auto A = nd::index_array(23, 5, 4) | nd::transform([] (auto i) { return double(i[0] * 20 + i[1] * 4 + i[2]); });
+    auto B = nd::make_unique_array<double>(A.shape());
+    auto C = nd::make_unique_array<double>(A.shape());
+    auto num_chunks = 0;
+    auto total = 0.0;
+
+    nd::evaluate_in_chunks(A, 5, [&] (const auto& region, auto chunk)
+    {
+        REQUIRE(chunk.shape() == region.shape());
+        REQUIRE(region.start[0] == std::size_t(5 * num_chunks));
+        REQUIRE(region.shape()[0] == std::size_t(num_chunks < 4 ? 5 : 3));
+
+        for (auto index : chunk.indexes())
+        {
+            auto global = index;
+            global[0] += region.start[0];
+            B(global) = chunk(index);
+        }
+        total += chunk | nd::sum();
+        ++num_chunks;
+    });
+    nd::evaluate_in_chunks(A, 7, [&] (const auto& region, auto chunk)
+    {
+        for (auto index : chunk.indexes())
+        {
+            auto global = index;
+            global[0] += region.start[0];
+            C(global) = chunk(index);
+        }
+    }, pool);
+
+    REQUIRE(num_chunks == 5);
+    REQUIRE(total == (A | nd::sum()));
+    REQUIRE(bool((A == std::move(B).shared()) | nd::all()));
+    REQUIRE(bool((A == std::move(C).shared()) | nd::all()));
+    REQUIRE_THROWS_AS(nd::evaluate_in_chunks(A, 0, [] (const auto&, auto) {}), std::logic_error);
+}
+
+TEST_CASE("block-sparse arrays store only the tiles that differ from the background", "[block_sparse]")
+{
+    auto pool = nd::thread_pool_t(3);
+    auto A = nd::index_array(50, 40, 3) | nd::transform([] (auto i)
+    {
+        return (i[0] >= 10 && i[0] < 14 && i[1] >= 30) ? double(i[0] + i[1] + i[2]) : 1.5;
+    });
+    auto B = A | nd::to_block_sparse(nd::make_shape(8, 8, 3), 1.5);
+    auto C = A | nd::to_block_sparse_parallel(pool, nd::make_shape(8, 8, 3), 1.5);
+
+    REQUIRE(nd::is_block_sparse_v<decltype(B)>);
+    REQUIRE(B.get_provider().num_tiles() == 7 * 5);
+    REQUIRE(B.get_provider().num_dense_tiles() == 2);
+    REQUIRE(C.get_provider().num_dense_tiles() == 2);
+    REQUIRE(bool((A == B) | nd::all()));
+    REQUIRE(bool((A == C) | nd::all()));
+    REQUIRE(bool((A == (B | nd::to_shared())) | nd::all()));
+    REQUIRE((B | nd::sum()) == (A | nd::sum()));
+    REQUIRE((B | nd::sum_on(pool)) == (A | nd::sum()));
+    REQUIRE((B | nd::select_from(5, 7, 0).to(40, 33, 3) | nd::sum()) == (A | nd::select_from(5, 7, 0).to(40, 33, 3) | nd::sum()));
+
+    SECTION("a uniform array has no dense tiles")
+    {
+        auto D = nd::promote(2, nd::make_shape(9, 9)) | nd::to_block_sparse(nd::make_shape(4, 4), 2);
+        REQUIRE(D.get_provider().num_dense_tiles() == 0);
+        REQUIRE((D | nd::sum()) == 162);
+    }
+
+    SECTION("tiles must not be empty")
+    {
+        REQUIRE_THROWS_AS(A | nd::to_block_sparse(nd::make_shape(8, 0, 3), 1.5), std::logic_error);
+    }
+}
+
+TEST_CASE("tuple-valued arrays can be stored as struct-of-arrays, and unzipped", "[to_shared_soa] [unzip]")
+{
+    auto pool = nd::thread_pool_t(3);
+    auto A = nd::index_array(30, 20) | nd::transform([] (auto i) { return double(i[0] * 20 + i[1]); });
+    auto B = nd::index_array(30, 20) | nd::transform([] (auto i) { return int(i[0] - i[1]); });
+    auto AB = nd::zip_arrays(A, B);
+    auto S = AB | nd::to_shared_soa();
+    auto T = AB | nd::to_shared_soa_parallel(pool);
+
+    REQUIRE(nd::is_soa_v<decltype(S)>);
+    REQUIRE(S(7, 3) == std::make_tuple(143.0, 4));
+    REQUIRE(bool((S == AB) | nd::all()));
+    REQUIRE(bool((T == AB) | nd::all()));
+    REQUIRE(bool(((S | nd::to_shared()) == AB) | nd::all()));
+
+    auto [x, y] = S | nd::unzip();
+    REQUIRE(nd::is_strided_v<decltype(x)>);
+    REQUIRE(x.data() == S.get_provider().component<0>().data());
+    REQUIRE(y.data() == S.get_provider().component<1>().data());
+    REQUIRE(bool((x == A) | nd::all()));
+    REQUIRE(bool((y == B) | nd::all()));
+
+    SECTION("other tuple-valued arrays are unzipped lazily")
+    {
+        auto [u, v] = AB | nd::unzip();
+        REQUIRE(bool((u == A) | nd::all()));
+        REQUIRE(bool((v == B) | nd::all()));
+    }
+
+    SECTION("struct-of-arrays arrays can be reshaped")
+    {
+        auto R = S | nd::reshape(600);
+        REQUIRE(R(143) == std::make_tuple(143.0, 4));
+    }
+}
+
+TEST_CASE("concatenated and patched arrays are evaluated a piece of a row at a time", "[concat] [replace] [evaluate_row]")
+{
+    auto A = nd::index_array(6, 9) | nd::transform([] (auto i) { return double(i[0] * 10 + i[1]); }) | nd::to_shared();
+    auto B = nd::index_array(6, 4) | nd::transform([] (auto i) { return double(-1 - i[0] * 10 - i[1]); });
+    auto elementwise = [] (auto X)
+    {
+        auto result = nd::make_unique_array<double>(X.shape());
+
+        for (auto index : X.indexes())
+        {
+            result(index) = X(index);
+        }
+        return std::move(result).shared();
+    };
+    auto check = [&] (auto X)
+    {
+        auto Y = X | nd::to_shared();
+        auto Z = elementwise(X);
+        REQUIRE(bool((Y == Z) | nd::all()));
+        REQUIRE((X | nd::sum()) == (Z | nd::sum()));
+    };
+
+    check(A | nd::concat(B).on_axis(1));
+    check(B | nd::concat(A).on_axis(1));
+    check(A | nd::concat(A).on_axis(0));
+    check(A | nd::replace_from(2, 3).to(4, 7).with(B | nd::select_from(0, 0).to(2, 4)));
+    check(A | nd::replace_from(1, 1).to(6, 9).jumping(2, 3).with(B | nd::select_from(0, 0).to(3, 3)));
+    check(A | nd::replace_from(0, 0).to(6, 4).with(B) | nd::concat(B).on_axis(1) | nd::replace_from(3, 8).to(5, 12).with(B | nd::select_from(0, 0).to(2, 4)));
+}
+
+TEST_CASE("axes can be permuted, without copying memory-backed arrays", "[permute_axes]")
+{
+    auto A = nd::index_array(70, 50, 3) | nd::transform([] (auto i) { return double(i[0] * 1000 + i[1] * 10 + i[2]); }) | nd::to_shared();
+    auto B = A | nd::permute_axes(2, 0, 1);
+    auto C = nd::index_array(70, 50, 3) | nd::permute_axes(1, 2, 0);
+
+    REQUIRE(B.shape() == nd::make_shape(3, 70, 50));
+    REQUIRE(C.shape() == nd::make_shape(50, 3, 70));
+    REQUIRE(nd::is_strided_v<decltype(B)>);
+    REQUIRE(B.data() == A.data());
+    REQUIRE(B(2, 31, 17) == A(31, 17, 2));
+    REQUIRE(C(17, 2, 31) == nd::make_index(31, 17, 2));
+
+    auto D = B | nd::to_shared();
+    auto E = nd::make_unique_array<double>(B.shape());
+
+    for (auto index : B.indexes())
+    {
+        E(index) = B(index);
+    }
+    REQUIRE(bool((D == std::move(E).shared()) | nd::all()));
+    REQUIRE(bool(((D | nd::permute_axes(1, 2, 0) | nd::to_shared()) == A) | nd::all()));
+    REQUIRE(bool(((A | nd::select_axis(0).from(1).to(60) | nd::permute_axes(1, 0, 2) | nd::to_shared())(4, 7, 1) == A(8, 4, 1))));
+    REQUIRE_THROWS_AS(nd::permute_axes(0, 0, 1), std::logic_error);
+    REQUIRE_THROWS_AS(nd::permute_axes(0, 3, 1), std::logic_error);
+}
+
+TEST_CASE("unique and memory-mapped arrays are permuted without copying", "[permute_axes] [unique_provider] [mmap_provider]")
+{
+    auto A = nd::index_array(6, 4) | nd::transform([] (auto i) { return double(i[0] * 10 + i[1]); }) | nd::to_shared();
+    auto U = nd::make_unique_array<double>(6, 4);
+
+    for (auto index : U.indexes())
+    {
+        U(index) = A(index);
+    }
+    auto data = U.data();
+    auto Ut = std::move(U) | nd::permute_axes(1, 0);
+
+    REQUIRE(nd::is_memory_backed_v<decltype(Ut)>);
+    REQUIRE(Ut.data() == data);
+    REQUIRE(Ut.shape() == nd::make_shape(4, 6));
+    REQUIRE(Ut(3, 5) == A(5, 3));
+
+    auto filename = std::string("test_permute_axes.npy");
+    nd::save_npy(filename, A);
+    {
+        auto Mt = nd::map_npy<double, 2>(filename) | nd::permute_axes(1, 0);
+
+        REQUIRE(nd::is_memory_backed_v<decltype(Mt)>);
+        REQUIRE(Mt.shape() == nd::make_shape(4, 6));
+        REQUIRE(Mt(3, 5) == A(5, 3));
+        REQUIRE(bool(((Mt | nd::to_shared()) == (A | nd::permute_axes(1, 0))) | nd::all()));
+    }
+    std::remove(filename.data());
+}
+
+TEST_CASE("static arrays have a compile-time shape and inline storage", "[static_array]")
+{
+    constexpr auto I = nd::make_static_array<double, 3, 3>({1, 0, 0, 0, 1, 0, 0, 0, 1});
+    constexpr auto trace = [] (const nd::static_array<double, 3, 3>& a) { return a(0, 0) + a(1, 1) + a(2, 2); };
+
+    static_assert(I(1, 1) == 1.0 && I(1, 2) == 0.0);
+    static_assert(I.shape() == nd::make_shape(3, 3));
+    static_assert(I.size() == 9);
+    static_assert(trace(I) == 3.0);
+    static_assert(sizeof(I) == 9 * sizeof(double));
+    static_assert(nd::is_contiguous_v<decltype(I)>);
+
+    auto F = nd::make_unique_array<nd::static_array<double, 3, 3>>(4, 5);
+
+    for (auto index : F.indexes())
+    {
+        F(index) = I;
+    }
+    F(2, 3)(0, 2) = 7.0;
+    F(2, 3)(2, 2) = 4.0;
+
+    auto G = std::move(F).shared();
+    REQUIRE((G | nd::transform(trace) | nd::sum()) == 19 * 3.0 + 6.0);
+    REQUIRE(G(2, 3)(0, 2) == 7.0);
+    REQUIRE(G(2, 2)(0, 2) == 0.0);
+
+    auto K = nd::make_static_array<double, 3>({1, -2, 1});
+    auto A = nd::index_array(10) | nd::transform([] (auto i) { return double(i[0] * i[0]); });
+    REQUIRE(bool(((A | nd::stencil(K)) == 2.0) | nd::all()));
+    REQUIRE(((I + I) | nd::sum()) == 6.0);
+    REQUIRE((I | nd::to_shared())(2, 2) == 1.0);
+    REQUIRE((I | nd::reshape(9))(4) == 1.0);
+
+    auto filename = std::string("test_static_array.npy");
+    auto S = nd::make_static_array<double, 2, 3>({1, 2, 3, 4, 5, 6});
+    nd::save_npy(filename, S);
+    auto L = nd::load_npy<double, 2>(filename);
+    REQUIRE(L.shape() == S.shape());
+    REQUIRE(bool((L == S) | nd::all()));
+    std::remove(filename.data());
+}
+
+TEST_CASE("positive shifts of memory-backed arrays never point before their memory", "[shift_by] [shared_provider] [view_provider]")
+{
+    auto A = nd::index_array(12) | nd::transform([] (auto i) { return double(i[0]); }) | nd::to_shared();
+    auto memory = std::vector<double>(12);
+    auto V = nd::make_view(memory.data(), nd::make_shape(12));
+    std::iota(memory.begin(), memory.end(), 0.0);
+
+    auto readable = nd::index_array(8) | nd::transform([] (auto i) { return nd::make_index(i[0] + 2); }) | nd::to_shared();
+
+    for (auto S : {A | nd::shift_by(+2) | nd::read_indexes(readable) | nd::to_shared(),
+                   A | nd::shift_by(+2) | nd::select_from(2).to(10) | nd::to_shared(),
+                   V | nd::shift_by(+2) | nd::select_from(2).to(10) | nd::to_shared()})
+    {
+        REQUIRE(S.shape() == nd::make_shape(8));
+        REQUIRE(S(0) == 0.0);
+        REQUIRE(S(7) == 7.0);
+    }
+    REQUIRE((V | nd::shift_by(+2)).data() == nullptr);
+    REQUIRE((V | nd::shift_by(+2) | nd::read_index(11)) == 9.0);
+}
+
+TEST_CASE("read_indexes and gather plans read memory-backed arrays at arbitrary indexes", "[read_indexes] [gather]")
+{
+    auto pool = nd::thread_pool_t(2);
+    auto A = nd::index_array(40, 30) | nd::transform([] (auto i) { return double(i[0] * 100 + i[1]); }) | nd::to_shared();
+    auto C = (A | nd::transform([] (double x) { return int(x) % 7; })) == 3;
+    auto I = nd::where(C);
+    auto O = nd::where_offsets(C);
+    auto V = A | nd::read_indexes(I) | nd::to_shared();
+
+    REQUIRE(V.size() == 171);
+    REQUIRE(V(0) == 3.0);
+    REQUIRE(bool(((A | nd::read_indexes(O) | nd::to_shared_parallel(pool)) == V) | nd::all()));
+    REQUIRE(bool(((A | nd::transform([] (double x) { return x; }) | nd::read_indexes(O) | nd::to_shared()) == V) | nd::all()));
+
+    auto W = A | nd::permute_axes(1, 0) | nd::read_indexes(nd::where(C | nd::permute_axes(1, 0))) | nd::to_shared();
+    REQUIRE(W.size() == 171);
+    REQUIRE(bool(((W | nd::transform([] (double x) { return int(x) % 7; })) == 3) | nd::all()));
+
+    auto plan = nd::make_gather_plan(I, A.shape());
+    REQUIRE(plan.shape() == V.shape());
+    REQUIRE(bool(((A | nd::gather(plan)) == V) | nd::all()));
+    REQUIRE(bool(((A | nd::gather_parallel(pool, nd::make_gather_plan(O, A.shape()))) == V) | nd::all()));
+    REQUIRE(bool(((A | nd::transform([] (double x) { return x; }) | nd::gather(plan)) == V) | nd::all()));
+
+    auto indexes = nd::make_unique_array<nd::index_t<2>>(3, 2);
+    indexes(0, 0) = nd::make_index(39, 29);
+    indexes(0, 1) = nd::make_index(0, 0);
+    indexes(1, 0) = nd::make_index(5, 5);
+    indexes(1, 1) = nd::make_index(39, 29);
+    indexes(2, 0) = nd::make_index(20, 1);
+    indexes(2, 1) = nd::make_index(0, 1);
+    auto J = std::move(indexes).shared();
+    auto G = A | nd::gather(nd::make_gather_plan(J, A.shape()));
+
+    REQUIRE(G.shape() == nd::make_shape(3, 2));
+    REQUIRE(G(0, 0) == 3929.0);
+    REQUIRE(G(1, 0) == 505.0);
+    REQUIRE(G(2, 1) == 1.0);
+    REQUIRE(bool((G == (A | nd::read_indexes(J))) | nd::all()));
+    REQUIRE_THROWS_AS(nd::make_gather_plan(J, nd::make_shape(10, 10)), std::logic_error);
+    REQUIRE_THROWS_AS(nd::zeros<double>(10, 10) | nd::gather(plan), std::logic_error);
+}
@@ -0,0 +1,117 @@
+#define CATCH_CONFIG_RUNNER
+#include "ndarray_mpi.hpp"
+#include "catch.hpp"
+
+
+
+
+// Run with e.g. mpirun -n 3 ./test_mpi; each process runs every test case.
+//=============================================================================
+int main(int argc, char* argv[])
+{
+    MPI_Init(&argc, &argv);
+    auto result = Catch::Session().run(argc, argv);
+    MPI_Finalize();
+    return result;
+}
+
+
+
+
+//=============================================================================
+template<typename ArrayType>
+auto periodic_padding(const ArrayType& A, std::size_t guard)
+{
+    auto n = A.shape(0);
+    return (A | nd::select_axis(0).from(n - guard).to(n)) | nd::concat(A) | nd::concat(A | nd::select_axis(0).from(0).to(guard));
+}
+
+auto make_global_array()
+{
+    return nd::index_array(13, 6) | nd::transform([] (auto i) { return double(i[0] * i[0] + 3 * i[1]); });
+}
+
+
+
+
+//=============================================================================
+TEST_CASE("arrays can be distributed over processes and gathered again", "[distribute] [gather]")
+{
+    auto A = make_global_array();
+    auto D = nd::mpi::distribute(MPI_COMM_WORLD, A, 2);
+    int process, num_processes;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_processes);
+
+    REQUIRE(D.global_shape() == A.shape());
+    REQUIRE(D.local_region() == nd::partition_shape(A.shape(), num_processes)[process]);
+    REQUIRE(D.local_with_guard().shape(0) == D.local().shape(0) + 4);
+    REQUIRE_FALSE(D.has_valid_guard());
+    REQUIRE(bool((D.gather() == A) | nd::all()));
+    REQUIRE_THROWS_AS(nd::mpi::distribute(MPI_COMM_WORLD, nd::zeros<double>(num_processes - 1, 4), 0), std::logic_error);
+}
+
+TEST_CASE("guard rows are filled from neighbouring processes", "[exchange]")
+{
+    auto A = make_global_array();
+    auto guard = std::size_t(2);
+
+    SECTION("periodic")
+    {
+        auto D = nd::mpi::distribute(MPI_COMM_WORLD, A, guard, true).exchange();
+        auto P = periodic_padding(A, guard) | nd::select_axis(0).from(D.local_region().start[0]).to(D.local_region().final[0] + 2 * guard);
+        REQUIRE(D.has_valid_guard());
+        REQUIRE(bool((D.local_with_guard() == P) | nd::all()));
+    }
+
+    SECTION("non-periodic")
+    {
+        auto D = nd::mpi::distribute(MPI_COMM_WORLD, A, guard).exchange();
+        auto i0 = D.local_region().start[0];
+        auto i1 = D.local_region().final[0];
+        auto G = D.local_with_guard();
+
+        for (std::size_t i = 0; i < G.shape(0); ++i)
+        {
+            auto global_row = std::ptrdiff_t(i0 + i) - std::ptrdiff_t(guard);
+            auto expected = global_row < 0 || global_row >= std::ptrdiff_t(A.shape(0)) ? 0.0 : A(global_row, 1);
+            REQUIRE(G(i, 1) == expected);
+        }
+        REQUIRE(bool((D.local() == (A | nd::select_axis(0).from(i0).to(i1))) | nd::all()));
+    }
+}
+
+TEST_CASE("pipelines on distributed arrays agree with the serial pipeline", "[map] [exchange_and_map]")
+{
+    auto A = make_global_array() | nd::to_shared();
+    auto K = nd::make_unique_array<double>(3, 3);
+    K(0, 1) = K(1, 0) = K(1, 2) = K(2, 1) = 1.0;
+    K(1, 1) = -4.0;
+    auto kernel = std::move(K).shared();
+    auto laplacian = [kernel] (auto array) { return array | nd::stencil(kernel); };
+    auto smooth = [] (auto array) { return (array | nd::shift_by(+1)) + (array | nd::shift_by(-1)) | nd::select_axis(0).from(1).to(array.shape(0) - 1); };
+
+    auto D = nd::mpi::distribute(MPI_COMM_WORLD, A, 1, true);
+    auto L1 = D.exchange().map(laplacian);
+    auto L2 = D.exchange_and_map(laplacian);
+    auto expected = periodic_padding(A, 1) | nd::stencil(kernel);
+
+    REQUIRE(L1.global_shape() == nd::make_shape(13, 4));
+    REQUIRE(bool((L1.gather() == expected) | nd::all()));
+    REQUIRE(bool((L2.gather() == expected) | nd::all()));
+    REQUIRE_THROWS_AS(D.map(laplacian), std::logic_error);
+    REQUIRE_THROWS_AS(D.exchange().map([kernel] (auto array) { return array | nd::select_axis(0).from(2).to(array.shape(0) - 2); }), std::logic_error);
+
+    SECTION("over several steps")
+    {
+        auto S = D;
+        auto B = A;
+
+        for (int n = 0; n < 4; ++n)
+        {
+            S = S.exchange_and_map(smooth);
+            B = periodic_padding(B, 1) | smooth | nd::to_shared();
+        }
+        REQUIRE(bool((S.gather() == B) | nd::all()));
+    }
+}
@@ -0,0 +1,85 @@
+#define NDARRAY_ENABLE_STATS
+#include "ndarray.hpp"
+#include "catch.hpp"
+
+
+
+
+/**
+ * Tests of the instrumentation counters. NDARRAY_ENABLE_STATS must be
+ * defined in every translation unit that includes ndarray.hpp, so these are
+ * built as a separate executable (test_stats) rather than linked into test,
+ * which checks the default, uninstrumented configuration.
+ */
+
+
+
+
+//=============================================================================
+TEST_CASE("instrumentation counts allocations, evaluations and element accesses", "[stats]")
+{
+    auto A = nd::index_array(20, 30) | nd::transform([] (auto i) { return double(i[0] + i[1]); });
+    auto B = A | nd::select_axis(0).from(5).to(15);
+
+    nd::reset_stats();
+    auto C = B | nd::to_shared();
+    auto stats = nd::stats();
+
+    REQUIRE(stats.evaluations == 1);
+    REQUIRE(stats.evaluated_elements == 300);
+    REQUIRE(stats.allocations == 1);
+    REQUIRE(stats.allocated_bytes == 300 * sizeof(double));
+    REQUIRE(stats.element_accesses["select_axis"] == 300);
+    REQUIRE(stats.element_accesses["transform"] == 300);
+    REQUIRE(stats.element_accesses["binary_op"] == 0);
+    REQUIRE(stats.evaluation_seconds >= 0.0);
+
+    auto D = (C + C) | nd::to_shared();
+    REQUIRE(nd::stats().evaluations == 2);
+    REQUIRE(nd::stats().element_accesses["binary_op"] == 300);
+
+    nd::reset_stats();
+    REQUIRE(nd::stats().evaluations == 0);
+    REQUIRE(nd::stats().element_accesses["transform"] == 0);
+}
+
+TEST_CASE("evaluating into existing unique arrays allocates nothing", "[stats] [evaluate_into] [double_buffer]")
+{
+    nd::thread_pool_t pool(3);
+    auto A = nd::index_array(20, 30) | nd::transform([] (auto i) { return double(i[0] * 30 + i[1]); });
+    auto B = nd::make_unique_array<double>(20, 30);
+    auto C = nd::make_unique_array<double>(20, 30);
+
+    nd::reset_stats();
+    nd::evaluate_into(B, A);
+    nd::evaluate_into(C, A * 2.0, pool);
+    REQUIRE(nd::stats().allocations == 0);
+    REQUIRE(nd::stats().evaluations == 2);
+
+    auto state = nd::double_buffer_t<2, double>(A);
+    auto update = [] (auto S) { return S | nd::transform([] (double x) { return 0.5 * x + 1.0; }); };
+
+    nd::reset_stats();
+
+    for (int n = 0; n < 10; ++n)
+    {
+        if (n % 2) state.step(update);
+        else       state.step(update, pool);
+    }
+    REQUIRE(nd::stats().evaluations == 10);
+    REQUIRE(nd::stats().allocations == 0);
+}
+
+TEST_CASE("cached arrays allocate their memory on first access", "[stats] [cache]")
+{
+    auto A = nd::index_array(20, 30) | nd::transform([] (auto i) { return double(i[0] + i[1]); });
+
+    nd::reset_stats();
+    auto X = A | nd::cache(nd::make_shape(4, 4));
+    REQUIRE(nd::stats().allocations == 0);
+
+    REQUIRE(X(3, 5) == 8.0);
+    REQUIRE(X(19, 29) == 48.0);
+    REQUIRE(nd::stats().allocations == 1);
+    REQUIRE(nd::stats().allocated_bytes == 600 * sizeof(double));
+}